@@ -0,0 +1,149 @@
+/***********************************************************************
+ * BatchRunner.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the BatchRunner class, which runs a
+ *              single GritVM program over many initial memories.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "BatchRunner.hpp"
+#include "LockstepEngine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+// number of inputs a parallel worker claims at a time
+static const size_t BATCH_CHUNK = 64;
+
+// constructor, nothing is loaded until the first run
+BatchRunner::BatchRunner(const std::string filename, ENGINE engine) : filename(filename), engine(engine) {}
+
+// constructor for a program that is already loaded, e.g. one shared with other runners
+BatchRunner::BatchRunner(std::shared_ptr<const GritProgram> program, ENGINE engine) : engine(engine), program(program) {}
+
+// returns worker context [index], creating it on first use. The program is loaded the first time any
+// worker is created; throws if it cannot be opened
+GritContext& BatchRunner::worker(size_t index)
+{
+    if (!program)
+        program = GritProgram::fromFile(filename);
+
+    if (workers.size() <= index)
+        workers.resize(index + 1);
+
+    if (!workers[index])
+    {
+        std::unique_ptr<GritContext> context(new GritContext());
+        context->attach(program, std::vector<long>());
+        workers[index] = std::move(context);
+    }
+    return *workers[index];
+}
+
+// runs [vm] on inputs [begin, end) with [engine], writing outputs and statuses at the same positions
+static void runRange(GritContext& vm, ENGINE engine, const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs,
+                     std::vector<STATUS>& statuses, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        STATUS status = vm.restart(inputs[i]);
+        if (status != READY)
+        {   // the program failed to load (or is empty), so memory is left as given
+            statuses[i] = status;
+            outputs[i] = inputs[i];
+            continue;
+        }
+        statuses[i] = vm.run(engine);
+        vm.copyDataMem(outputs[i]);
+    }
+}
+
+// runs the program over every entry of [inputs] on a single VM, see header
+std::vector<STATUS> BatchRunner::run(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs)
+{
+    std::vector<STATUS> statuses(inputs.size(), WAITING);
+    outputs.resize(inputs.size());
+
+    runRange(worker(0), engine, inputs, outputs, statuses, 0, inputs.size());
+    return statuses;
+}
+
+// runs the program over every entry of [inputs] on [threads] worker threads, see header. Workers claim
+// chunks of inputs from a shared counter, so uneven run times balance out. The first exception thrown
+// by any run is rethrown once every worker has stopped
+std::vector<STATUS> BatchRunner::runParallel(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs, unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, (inputs.size() + BATCH_CHUNK - 1) / BATCH_CHUNK));
+    if (threads <= 1)
+        return run(inputs, outputs);
+
+    std::vector<STATUS> statuses(inputs.size(), WAITING);
+    outputs.resize(inputs.size());
+
+    // create every worker up front, so load errors surface here rather than inside a thread
+    for (unsigned t = 0; t < threads; ++t)
+        worker(t);
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        pool.push_back(std::thread([&, t]() {
+            GritContext& vm = *workers[t];
+            try
+            {
+                while (!failed.load(std::memory_order_relaxed))
+                {
+                    size_t begin = next.fetch_add(BATCH_CHUNK);
+                    if (begin >= inputs.size())
+                        break;
+                    runRange(vm, engine, inputs, outputs, statuses, begin, std::min(begin + BATCH_CHUNK, inputs.size()));
+                }
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+                failed.store(true);
+            }
+        }));
+    }
+
+    for (std::thread& th : pool)
+        th.join();
+
+    for (std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    return statuses;
+}
+
+// runs the program over every entry of [inputs] with the lockstep engine, see header
+std::vector<STATUS> BatchRunner::runLockstep(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs, unsigned width)
+{
+    std::vector<STATUS> statuses(inputs.size(), WAITING);
+    outputs.resize(inputs.size());
+
+    worker(0);  // loads the program
+    if (program->status() != READY)
+    {   // the program failed to load (or is empty), so memory is left as given
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            statuses[i] = program->status();
+            outputs[i] = inputs[i];
+        }
+        return statuses;
+    }
+
+    LockstepEngine::run(*program, inputs.data(), outputs.data(), statuses.data(), inputs.size(), width);
+    return statuses;
+}
@@ -0,0 +1,50 @@
+/***********************************************************************
+ * BatchRunner.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the BatchRunner class, which loads a GritVM
+ *              program once and runs it over a batch of initial memories,
+ *              collecting the resulting data memories. The parallel variant
+ *              spreads the batch over worker threads; they all share the one
+ *              GritProgram and each has its own GritContext, restarted for
+ *              every input.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class BatchRunner
+{
+    private:
+        std::string filename;                                   // program to load
+        ENGINE engine;                                          // engine every context runs with
+        std::shared_ptr<const GritProgram> program;             // loaded once, shared by every worker
+        std::vector<std::unique_ptr<GritContext> > workers;     // contexts reused across calls; workers[0] serves run()
+
+        GritContext& worker(size_t index);                      // creates worker [index] on first use
+
+    public:
+        BatchRunner(const std::string filename, ENGINE engine = THREADED_ENGINE);
+        BatchRunner(std::shared_ptr<const GritProgram> program, ENGINE engine = THREADED_ENGINE);
+
+        // runs the program once per entry of [inputs], leaving the resulting data memories in the matching
+        // entries of [outputs]. Existing vectors in [outputs] are reused, so passing the same [outputs] to
+        // repeated calls avoids reallocating them. Returns the final status of each run
+        std::vector<STATUS> run(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs);
+
+        // as run(), split over [threads] worker threads (0 = one per hardware thread)
+        std::vector<STATUS> runParallel(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs, unsigned threads = 0);
+
+        // as run(), executing [width] (4 or 8) inputs at a time in lockstep SIMD lanes (see LockstepEngine.hpp)
+        std::vector<STATUS> runLockstep(const std::vector<std::vector<long> >& inputs, std::vector<std::vector<long> >& outputs, unsigned width = 8);
+};
+
+#endif // BATCHRUNNER_H
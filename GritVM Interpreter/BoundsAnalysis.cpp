@@ -0,0 +1,149 @@
+/***********************************************************************
+ * BoundsAnalysis.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the BoundsAnalysis class, which
+ *              proves data memory accesses of a GritVM program in bounds.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "BoundsAnalysis.hpp"
+
+#include <algorithm>
+#include <climits>
+
+// number of times an instruction's bound may be lowered before it is widened straight to 0, so loops
+// that ERASE converge quickly instead of stepping the bound down one cell per pass
+static const int WIDEN_AFTER = 8;
+
+// returns the data memory size [instruct] needs, see header
+long BoundsAnalysis::requiredSize(const Instruction& instruct)
+{
+    long arg = instruct.argument;
+    switch (instruct.operation)
+    {
+        case AT:
+        case SET:
+        case ERASE:
+        case ADDMEM:
+        case SUBMEM:
+        case MULMEM:
+        case DIVMEM:
+            return (arg == LONG_MAX) ? LONG_MAX : arg + 1;
+        case INSERT:
+            return arg;
+        default:
+            return -1;
+    }
+}
+
+// analyzes the [count] instructions at [program], replacing any previous result. Runs a worklist over
+// the control flow graph until the bound on reaching every instruction stops changing
+void BoundsAnalysis::analyze(const Instruction* program, int count)
+{
+    clear();
+    minSize.assign(count, -1);
+    unproven.assign(count, 0);
+
+    std::vector<int> lowered(count, 0);
+    std::vector<long> work;
+
+    // merges bound [size] into instruction [target]; landing one past the end simply ends the program
+    auto flowTo = [&](long target, long size) {
+        if (target >= count)
+            return;
+        long old = minSize[target];
+        long merged = (old < 0) ? size : std::min(old, size);
+        if (merged == old)
+            return;
+        if (old >= 0 && ++lowered[target] > WIDEN_AFTER)
+            merged = 0;
+        minSize[target] = merged;
+        work.push_back(target);
+    };
+
+    if (count > 0)
+        flowTo(0, 0);
+
+    while (!work.empty())
+    {
+        long i = work.back();
+        work.pop_back();
+
+        const Instruction& instruct = program[i];
+        long arg = instruct.argument;
+        long in = minSize[i];
+
+        switch (instruct.operation)
+        {
+            case JUMPREL:
+            case JUMPZERO:
+            case JUMPNZERO:
+            {   // a jump of 0 or out of the program throws, so only valid targets are successors
+                long target = i + arg;
+                if (arg != 0 && target >= 0 && target <= count)
+                    flowTo(target, in);
+                if (instruct.operation != JUMPREL && arg != 0)
+                    flowTo(i + 1, in);
+                break;
+            }
+            case HALT:
+                break;
+            case CHECKMEM:
+                flowTo(i + 1, std::max(in, arg));
+                break;
+            case CLEAR:
+            case ADDCONST:
+            case SUBCONST:
+            case MULCONST:
+            case DIVCONST:
+            case NOOP:
+            case OUTPUT:
+            case LOADREG:
+            case STOREREG:
+            case ADDREG:
+            case SUBREG:
+            case MULREG:
+            case DIVREG:
+                flowTo(i + 1, in);
+                break;
+            default:
+            {
+                long required = requiredSize(instruct);
+                if (required < 0 || arg < 0)
+                    break;      // UNKNOWN_INSTRUCTION throws, as does any access at a negative index
+
+                // execution only gets past the access if the memory held at least [required] cells
+                long size = std::max(in, required);
+                if (instruct.operation == INSERT)
+                    size = (size == LONG_MAX) ? size : size + 1;
+                else if (instruct.operation == ERASE)
+                    size = size - 1;
+                flowTo(i + 1, size);
+                break;
+            }
+        }
+    }
+
+    // an access is proven if every path reaching it leaves enough memory
+    for (long i = 0; i < count; ++i)
+    {
+        long required = requiredSize(program[i]);
+        if (required < 0)
+            continue;
+        ++accessCount;
+        if (minSize[i] >= 0 && program[i].argument >= 0 && required <= minSize[i])
+            ++provenCount;
+        else
+            unproven[i] = 1;
+    }
+}
+
+// removes the analysis result
+void BoundsAnalysis::clear()
+{
+    minSize.clear();
+    unproven.clear();
+    accessCount = 0;
+    provenCount = 0;
+}
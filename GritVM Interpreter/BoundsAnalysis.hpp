@@ -0,0 +1,52 @@
+/***********************************************************************
+ * BoundsAnalysis.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the BoundsAnalysis class, a load-time
+ *              dataflow analysis that proves which data memory accesses of
+ *              a GritVM program are always in bounds.
+ *
+ *              For every instruction it computes a lower bound on the data
+ *              memory size whenever that instruction is reached. Bounds
+ *              start at 0 (nothing is known about the initial memory) and
+ *              are raised by CHECKMEM (execution only continues past it if
+ *              the memory is large enough), INSERT and by checked accesses
+ *              (execution only continues past them if they were in bounds),
+ *              and lowered by ERASE. Where control flow merges the smallest
+ *              bound wins. An access is proven when its index is below the
+ *              bound on every path; only the others need a run-time check.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef BOUNDSANALYSIS_H
+#define BOUNDSANALYSIS_H
+
+#include "GritVMBase.hpp"
+
+#include <vector>
+
+class BoundsAnalysis
+{
+    private:
+        std::vector<long> minSize;          // lower bound on data memory size on reaching each instruction, -1 if unreachable
+        std::vector<char> unproven;         // 1 if the instruction accesses data memory and is not proven in bounds
+        int accessCount;                    // instructions that access data memory
+        int provenCount;                    // of those, the ones proven in bounds
+
+    public:
+        BoundsAnalysis() : accessCount(0), provenCount(0) {};
+
+        void analyze(const Instruction* program, int count);   // analyzes [program], replacing any previous result
+        void clear();
+
+        bool needsCheck(long index) const { return unproven[index] != 0; };   // true if instruction [index] must be checked at run time
+        long minimumSize(long index) const { return minSize[index]; };       // proven lower bound on memory size at [index], -1 if unreachable
+        int accesses() const { return accessCount; };
+        int proven() const { return provenCount; };
+
+        // data memory size [instruct] needs to be in bounds (index + 1, or index for INSERT), -1 if it does not
+        // access data memory. An access with a negative index is never in bounds
+        static long requiredSize(const Instruction& instruct);
+};
+
+#endif // BOUNDSANALYSIS_H
@@ -0,0 +1,216 @@
+/***********************************************************************
+ * BytecodeImage.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the BytecodeImage class, which
+ *              compiles .gvm source to the .gvmb bytecode format and maps
+ *              .gvmb files for execution.
+ *
+ *              See header file for the file layout and class architecture
+ * *********************************************************************/
+
+#include "BytecodeImage.hpp"
+#include "GVMParser.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GVM_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char GVMB_MAGIC[4] = { 'G', 'V', 'M', 'B' };
+
+// true if a record can be used as an Instruction without conversion
+static bool recordMatchesInstruction()
+{
+    const uint16_t probe = 1;
+    bool littleEndian = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    return littleEndian
+        && sizeof(Instruction) == sizeof(GvmbRecord)
+        && sizeof(INSTRUCTION_SET) == sizeof(int32_t)
+        && sizeof(long) == sizeof(int64_t)
+        && offsetof(Instruction, argument) == offsetof(GvmbRecord, argument);
+}
+
+// true if [filename] ends in .gvmb
+bool BytecodeImage::isBytecodeFile(const std::string filename)
+{
+    const std::string extension = ".gvmb";
+    return filename.size() >= extension.size()
+        && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// 32-bit FNV-1a hash of [length] [bytes]
+uint32_t BytecodeImage::checksum(const unsigned char* bytes, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// compiles the GritVM program in [sourceFile] to .gvmb bytecode in [outputFile], parsing it with
+// GVMParser like GritVM::load(). Throws if either file cannot be opened or if a line is malformed
+// (the message carries the line and column). Returns the number of instructions written
+int BytecodeImage::compile(const std::string sourceFile, const std::string outputFile)
+{
+    std::ifstream source(sourceFile, std::ios::binary);
+    if (!source)
+        throw std::runtime_error(sourceFile + " could not be opened");
+    std::string text((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+
+    CustomVector<Instruction> instructions;
+    ParseError error;
+    if (!GVMParser::parse(text, instructions, error))
+        throw std::invalid_argument(sourceFile + ":" + error.toString());
+
+    return write(instructions.data(), static_cast<int>(instructions.size()), outputFile);
+}
+
+// writes the [count] instructions at [program] to [outputFile] as .gvmb bytecode. Throws if the file
+// cannot be written. Returns the number of instructions written
+int BytecodeImage::write(const Instruction* program, int count, const std::string outputFile)
+{
+    std::string records;
+    for (int i = 0; i < count; ++i)
+    {
+        GvmbRecord record;
+        record.operation = static_cast<int32_t>(program[i].operation);
+        record.reserved = 0;
+        record.argument = static_cast<int64_t>(program[i].argument);
+        records.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    GvmbHeader header;
+    std::memcpy(header.magic, GVMB_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.count = static_cast<uint32_t>(records.size() / sizeof(GvmbRecord));
+    header.checksum = checksum(reinterpret_cast<const unsigned char*>(records.data()), records.size());
+
+    std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+    if (!output)
+        throw std::runtime_error(outputFile + " could not be opened");
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(records.data(), records.size());
+    if (!output)
+        throw std::runtime_error(outputFile + " could not be written");
+
+    return static_cast<int>(header.count);
+}
+
+// maps [filename] and validates its header, checksum and opcodes, replacing any previous image.
+// Throws if the file cannot be opened, returns false if it is not a valid .gvmb file
+bool BytecodeImage::open(const std::string filename)
+{
+    clear();
+
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+    std::string buffer;      // holds the file when it could not be mapped
+
+#ifdef GVM_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(filename + " could not be opened");
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void* mem = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem != MAP_FAILED)
+        {
+            mapping = mem;
+            mappedSize = static_cast<size_t>(info.st_size);
+            bytes = static_cast<const unsigned char*>(mem);
+            length = mappedSize;
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (bytes == nullptr)
+    {   // no mmap on this host (or an empty file): read it instead
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+            throw std::runtime_error(filename + " could not be opened");
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = reinterpret_cast<const unsigned char*>(buffer.data());
+        length = buffer.size();
+    }
+
+    // validate the header
+    GvmbHeader header;
+    if (length < sizeof(header))
+    {
+        clear();
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, GVMB_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION
+        || length != sizeof(header) + static_cast<size_t>(header.count) * sizeof(GvmbRecord)
+        || header.count > static_cast<uint32_t>(INT32_MAX))
+    {
+        clear();
+        return false;
+    }
+
+    const unsigned char* recordBytes = bytes + sizeof(header);
+    if (checksum(recordBytes, length - sizeof(header)) != header.checksum)
+    {
+        clear();
+        return false;
+    }
+
+    // every opcode must be a real instruction, since engines index tables with it
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        GvmbRecord record;
+        std::memcpy(&record, recordBytes + i * sizeof(GvmbRecord), sizeof(record));
+        if (record.operation < 0 || record.operation >= UNKNOWN_INSTRUCTION || record.reserved != 0)
+        {
+            clear();
+            return false;
+        }
+    }
+
+    count = static_cast<int>(header.count);
+    if (mapping != nullptr && recordMatchesInstruction())
+    {   // execute straight out of the mapping
+        instructions = reinterpret_cast<const Instruction*>(recordBytes);
+        return true;
+    }
+
+    // otherwise convert the records once
+    converted.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        GvmbRecord record;
+        std::memcpy(&record, recordBytes + i * sizeof(GvmbRecord), sizeof(record));
+        converted.push_back(Instruction(static_cast<INSTRUCTION_SET>(record.operation), static_cast<long>(record.argument)));
+    }
+    instructions = converted.data();
+    return true;
+}
+
+// unmaps the current file
+void BytecodeImage::clear()
+{
+#ifdef GVM_HAVE_MMAP
+    if (mapping != nullptr)
+        munmap(mapping, mappedSize);
+#endif
+    mapping = nullptr;
+    mappedSize = 0;
+    instructions = nullptr;
+    count = 0;
+    converted.clear();
+}
@@ -0,0 +1,67 @@
+/***********************************************************************
+ * BytecodeImage.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the compiled GritVM bytecode format (.gvmb)
+ *              and the BytecodeImage class that memory-maps a .gvmb file.
+ *
+ *              File layout (little-endian):
+ *                  header:  char magic[4] = "GVMB", uint32 version,
+ *                           uint32 instruction count, uint32 checksum
+ *                  records: one per instruction, int32 opcode,
+ *                           int32 reserved (0), int64 argument
+ *
+ *              The checksum is 32-bit FNV-1a over all record bytes. Each
+ *              record has the same layout as Instruction on LP64 hosts, so
+ *              the mapped records are executed in place without copying.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef BYTECODEIMAGE_H
+#define BYTECODEIMAGE_H
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+typedef struct _gvmb_header {
+  char magic[4]; uint32_t version; uint32_t count; uint32_t checksum;
+} GvmbHeader;
+
+typedef struct _gvmb_record {
+  int32_t operation; int32_t reserved; int64_t argument;
+} GvmbRecord;
+
+class BytecodeImage
+{
+    private:
+        void* mapping;                              // the mapped file, nullptr when nothing is mapped
+        size_t mappedSize;                          // size of [mapping] in bytes
+        const Instruction* instructions;            // first instruction, either inside [mapping] or in [converted]
+        int count;                                  // number of instructions
+        CustomVector<Instruction> converted;        // copy of the records for hosts where Instruction has another layout
+
+        BytecodeImage(const BytecodeImage&);        // owns a mapping - not copyable
+        BytecodeImage& operator=(const BytecodeImage&);
+
+    public:
+        static const uint32_t VERSION = 1;
+
+        BytecodeImage() : mapping(nullptr), mappedSize(0), instructions(nullptr), count(0) {};
+        ~BytecodeImage() { clear(); };
+
+        bool open(const std::string filename);      // maps and validates [filename], false if it is not a valid .gvmb file
+        void clear();                               // unmaps the current file
+        const Instruction* data() const { return instructions; };
+        int size() const { return count; };
+
+        static bool isBytecodeFile(const std::string filename);                          // true if [filename] ends in .gvmb
+        static uint32_t checksum(const unsigned char* bytes, size_t length);             // FNV-1a over [bytes]
+        static int compile(const std::string sourceFile, const std::string outputFile);  // compiles a .gvm file to .gvmb, returns the instruction count
+        static int write(const Instruction* program, int count, const std::string outputFile);  // writes [program] as .gvmb
+};
+
+#endif // BYTECODEIMAGE_H
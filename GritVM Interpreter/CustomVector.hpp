@@ -2,7 +2,14 @@
  * CustomVector.hpp
  * Author: Matthew Sumpter
  * Description: Template file for Vector ADT class.
- * 
+ *
+ *              Storage is raw memory that grows geometrically (doubling), so
+ *              push_back is amortized O(1). Elements are constructed in place
+ *              and moved, not copied, when the array is reallocated. For
+ *              trivially copyable types (long, Instruction, ...) relocation,
+ *              insert and erase are single memcpy/memmove calls and clear() is
+ *              O(1).
+ *
  *              Note: Functionality is specifically restricted to the GritVM class
  * *********************************************************************************/
 #ifndef CUSTOMVECTOR_H
@@ -10,6 +17,11 @@
 
 #include <string>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template <typename E>
 class CustomVector
@@ -36,11 +48,11 @@ class CustomVector
                     --ptr_;
                     return *this;
                 };
-                Iterator operator+(E arg) const
+                Iterator operator+(long arg) const
                 {
                     return Iterator(this->ptr_ + arg);
                 };
-                Iterator operator-(E arg) const
+                Iterator operator-(long arg) const
                 {
                     return Iterator(this->ptr_ - arg);
                 };
@@ -56,119 +68,206 @@ class CustomVector
                 {
                     return ptr_ != second_it.ptr_;
                 };
-                void operator=(const E& new_elem)
-                {
-                    ptr_ = &new_elem;
-                };
 
                 friend class CustomVector;
         };
 
     private:
-        int capacity;                // current array size
-        int n;                       // number of elements in vector
+        // true if elements can be relocated with memcpy/memmove instead of being moved one by one
+        static const bool trivial = std::is_trivially_copyable<E>::value;
+
+        size_t capacity;             // current array size
+        size_t n;                    // number of elements in vector
         E* array;
 
+        static E* allocate(size_t N) { return static_cast<E*>(::operator new(N * sizeof(E))); }
+
+        // destroys the elements in [from, to); nothing to do for trivial types
+        void destroy(size_t from, size_t to)
+        {
+            if (!std::is_trivially_destructible<E>::value)
+                for (size_t j = from; j < to; j++)
+                    array[j].~E();
+        };
+
+        // grows the array to hold at least [N] elements, doubling the capacity so repeated growth is amortized O(1)
+        void grow(size_t N)
+        {
+            reserve(std::max(N, std::max<size_t>(8, 2 * capacity)));
+        };
+
+        // opens a one-element gap at [index], growing the array if necessary. The gap is raw memory for
+        // trivial types; otherwise it holds a moved-from element to be assigned over
+        void openGap(size_t index)
+        {
+            if (n >= capacity)
+                grow(n + 1);
+
+            if (trivial)
+                std::memmove(static_cast<void*>(array + index + 1), static_cast<const void*>(array + index), (n - index) * sizeof(E));
+            else if (index < n)
+            {   // move the last element into the uninitialized slot, then shift the rest up by one
+                ::new (static_cast<void*>(array + n)) E(std::move(array[n - 1]));
+                std::move_backward(array + index, array + n - 1, array + n);
+            }
+        };
+
     public:
         CustomVector() : capacity(0), n(0), array(nullptr) {};            // constructor initializes empty(0) sized array
-        ~CustomVector() { delete [] array; };                             // deconstructor
-        int size() const { return n; };                                   // returns number of elements stored in array
+        CustomVector(const CustomVector& other) : capacity(0), n(0), array(nullptr) { assign(other.array, other.n); };
+        CustomVector(CustomVector&& other) noexcept : capacity(other.capacity), n(other.n), array(other.array)
+        {
+            other.capacity = 0;
+            other.n = 0;
+            other.array = nullptr;
+        };
+        ~CustomVector()                                                   // deconstructor
+        {
+            destroy(0, n);
+            ::operator delete(array);
+        };
+
+        CustomVector& operator=(const CustomVector& other)
+        {
+            if (this != &other)
+                assign(other.array, other.n);
+            return *this;
+        };
+        CustomVector& operator=(CustomVector&& other) noexcept
+        {
+            std::swap(capacity, other.capacity);
+            std::swap(n, other.n);
+            std::swap(array, other.array);
+            return *this;
+        };
+
+        size_t size() const { return n; };                                // returns number of elements stored in array
         bool empty() const { return size() == 0; };                       // returns true if array is empty
-        E& operator[](int i) { return array[i]; };                        // overloads [] operator - no error checking
+        E& operator[](size_t i) { return array[i]; };                     // overloads [] operator - no error checking
+        const E& operator[](size_t i) const { return array[i]; };         // const overload of [] operator - no error checking
+        E* data() const { return array; };                                // returns the underlying array (nullptr if never allocated)
         Iterator begin() const { return Iterator(array); };               // returns an iterator to the first element in array
         Iterator end() const { return Iterator(array + n); };             // returns an iterator to the off-the-end position in the array
-        
-        // designates a new array of size [N], and reassigns the capacity to [N]
-        void reserve(int N)                                        
+
+        // designates a new array of size [N], and reassigns the capacity to [N]. Elements are moved (or
+        // memcpy'd for trivial types) into the new array
+        void reserve(size_t N)
         {
             if (capacity >= N)  // if function was called although capacity is already sufficient, return
                 return;
-            E* B = new E[N];    // allocate new array of desired size
-            // copy all elements from current array to new array
-            for (int j = 0; j < n; j++)
-                B[j] = array[j];
-            // if current array wasn't empty, delete it
-            if (array != nullptr)
-                delete [] array;
+            E* B = allocate(N); // allocate new array of desired size
+            if (trivial)
+            {
+                if (n > 0)
+                    std::memcpy(static_cast<void*>(B), static_cast<const void*>(array), n * sizeof(E));
+            }
+            else
+            {   // move all elements from current array to new array
+                for (size_t j = 0; j < n; j++)
+                {
+                    ::new (static_cast<void*>(B + j)) E(std::move_if_noexcept(array[j]));
+                    array[j].~E();
+                }
+            }
+            ::operator delete(array);
             // assign new array as member data, update capacity
             array = B;
             capacity = N;
         };
-        
-        // inserts element [e] at position in array pointed to by [i]
-        void insert(Iterator& i, E& e)
+
+        // replaces the contents with the [count] elements at [first]
+        void assign(const E* first, size_t count)
         {
-            // if more space is needed, increase size of array
-            if (n >= capacity)
-                reserve(std::max(1, 2 * capacity));
-                
-            // move all elements above [i] up by one position
-            for (auto j = end(); j >= i; --j)
+            clear();
+            reserve(count);
+            if (trivial)
             {
-                Iterator m = j + 1;
-                Iterator n = j;
-                *m = *n;
+                if (count > 0)
+                    std::memcpy(static_cast<void*>(array), static_cast<const void*>(first), count * sizeof(E));
             }
-            *i = e;         // assign new element [e] to position [i]
-            n++;            // increase num of elements stored
-        };
-        
-        // inserts element [e] at a position [arg] from the beginning (see above insert function)
-        void insert(long& arg, E& e)
-        {
-            if (n >= capacity)
-                reserve(std::max(1, 2 * capacity));
-
-            Iterator i(begin() + arg);
-            for (auto j = end(); j >= i; --j)
+            else
             {
-                Iterator m = j + 1;
-                Iterator n = j;
-                *m = *n;
+                for (size_t j = 0; j < count; j++)
+                    ::new (static_cast<void*>(array + j)) E(first[j]);
             }
+            n = count;
+        };
 
-            *i = e;
-            n++;
+        // inserts element [e] at position in array pointed to by [i]
+        void insert(Iterator i, const E& e)
+        {
+            insert(static_cast<long>(i.ptr_ - array), e);
+        };
+
+        // inserts element [e] at a position [arg] from the beginning
+        void insert(long arg, const E& e)
+        {
+            size_t index = static_cast<size_t>(arg);
+            E value(e);     // [e] may live in this array, which openGap() can reallocate
+            openGap(index);
+            if (trivial || index == n)
+                ::new (static_cast<void*>(array + index)) E(std::move(value));
+            else
+                array[index] = std::move(value);
+            n++;            // increase num of elements stored
         };
 
         // erase the element at position [i]
         void erase(Iterator i)
         {
-            Iterator j = i + 1;
+            E* pos = i.ptr_;
             // move all elements beyond [i] back one position
-            for (; j < end(); ++j)
+            if (trivial)
+                std::memmove(static_cast<void*>(pos), static_cast<const void*>(pos + 1), (array + n - pos - 1) * sizeof(E));
+            else
             {
-                Iterator m = j - 1;
-                Iterator n = j;
-                *m = *n;
+                std::move(pos + 1, array + n, pos);
+                array[n - 1].~E();
             }
             n--;   // decrement num of elements stored
         };
 
+        // erase the element at a position [arg] from the beginning (see above erase function)
+        void erase(long arg)
+        {
+            erase(begin() + arg);
+        };
+
         // pushes element [e] to the end of the array
-        void push_back(E e)
+        void push_back(const E& e)
         {
             // increases capacity if neccessary
             if (n >= capacity)
-                reserve(std::max(1, 2 * capacity));
+            {
+                E value(e);     // [e] may live in this array
+                grow(n + 1);
+                ::new (static_cast<void*>(array + n)) E(std::move(value));
+            }
+            else
+                ::new (static_cast<void*>(array + n)) E(e);
+            n++;
+        };
 
-            // if first entry, load element into a[0]
-            long first_entry = 0;
-            if (n == first_entry)
-                insert(first_entry, e);
+        // grows to [count] elements, the new ones value-initialized, or destroys the elements from [count] on
+        void resize(size_t count)
+        {
+            if (count < n)
+                destroy(count, n);
             else
-            {   // if not first entry, load element into end of array
-                Iterator end_ = end() - 1;
-                insert(end_, e);
+            {
+                reserve(count);
+                for (size_t j = n; j < count; j++)
+                    ::new (static_cast<void*>(array + j)) E();
             }
+            n = count;
         };
 
-        // erases every element in the array, n = 0
+        // erases every element in the array, n = 0. Capacity is kept; O(1) for trivial types
         void clear()
         {
-            while ( !empty() )
-                erase( begin() );
+            destroy(0, n);
+            n = 0;
         };
 };
 
-#endif // CUSTOMVECTOR_H
\ No newline at end of file
+#endif // CUSTOMVECTOR_H
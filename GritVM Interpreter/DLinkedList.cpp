@@ -43,7 +43,7 @@ bool DLinkedList::Iterator::operator!=(const DLinkedList::Iterator &p) const
 // adds a new node containing element [c] to the list before [insertBefore]
 void DLinkedList::add(Node* insertBefore, Instruction& c)
 {
-    Node *newNode = new Node;                       // allocate new node
+    Node *newNode = pool->allocate();               // allocate new node
     newNode->elem = c;
     newNode->next = insertBefore;                   // link new nodes next
     newNode->prev = insertBefore->prev;             // link new nodes previous
@@ -60,37 +60,52 @@ void DLinkedList::remove(Node* v)
         // relink nodes, excluding [v]
         v->prev->next = v->next;
         v->next->prev = v->prev;
-        delete v;
+        pool->release(v);
         --n;
     }
     else
         throw std::out_of_range("Error: List is empty");
 }
 
-/**************************************** Public Functions ****************************************/
-
-// constructor
-DLinkedList::DLinkedList()
+// allocates the sentinels and links them to each other
+void DLinkedList::linkSentinels()
 {
-    header = new Node;
-    trailer = new Node;
+    header = pool->allocate();
+    trailer = pool->allocate();
     header->next = trailer;
     trailer->prev = header;
-    n = 0;
 }
 
-// deconstructor
+/**************************************** Public Functions ****************************************/
+
+// constructor, taking nodes from [nodes] or, if nullptr, the list's own pool
+DLinkedList::DLinkedList(NodePool<Node>* nodes) : n(0), pool(nodes ? nodes : &ownPool)
+{
+    linkSentinels();
+}
+
+// deconstructor. The list's own pool frees its nodes with it
 DLinkedList::~DLinkedList()
 {
+    if (pool == &ownPool)
+        return;
     clear();
 
-    delete header;
-    delete trailer;
+    pool->release(header);
+    pool->release(trailer);
 }
 
-// clears the list of all elements
+// clears the list of all elements. With its own pool the list releases them all at once
 void DLinkedList::clear()
 {
+    if (pool == &ownPool)
+    {
+        ownPool.clear();
+        linkSentinels();
+        n = 0;
+        return;
+    }
+
     // while not empty, remove from back
     while (!empty())
         removeBack();
@@ -2,14 +2,17 @@
  * DLinkedList.hpp
  * Author: Matthew Sumpter
  * Description: Header file for a doubly-linked list class that uses
- *              Nodes containing strings. See implementation file for
- *              function descriptions
+ *              Nodes containing strings. Nodes are allocated from a
+ *              NodePool (see NodePool.hpp): the list's own, or one shared
+ *              with other lists. See implementation file for function
+ *              descriptions
  * *********************************************************************/
 #ifndef DLINKEDLIST_H
 #define DLINKEDLIST_H
 
 #include <string>
 #include "GritVMBase.hpp"
+#include "NodePool.hpp"
 
 
 class Node 
@@ -41,13 +44,19 @@ class DLinkedList
         Node *header;
         Node *trailer;
         int n;
+        NodePool<Node> ownPool;                                            // nodes of a list not given a pool
+        NodePool<Node>* pool;                                              // where the list's nodes come from
+
+        DLinkedList(const DLinkedList&);                                   // owns its nodes - not copyable
+        DLinkedList& operator=(const DLinkedList&);
 
     protected: // local utilities
         void add(Node *insertBefore, Instruction &c);
         void remove(Node *v);
+        void linkSentinels();
 
     public:
-        DLinkedList();
+        DLinkedList(NodePool<Node>* nodes = nullptr);                      // allocates from [nodes] if given, else from its own pool
         ~DLinkedList();
         int size() const { return n; };
         void clear();
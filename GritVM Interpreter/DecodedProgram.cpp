@@ -0,0 +1,233 @@
+/***********************************************************************
+ * DecodedProgram.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the DecodedProgram class, which
+ *              validates a loaded GritVM program and translates it into
+ *              handler entries for the threaded execution engine.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "DecodedProgram.hpp"
+
+#include <algorithm>
+#include <climits>
+
+// returns true if [instruct] is a relative jump
+static bool isJump(const Instruction& instruct)
+{
+    return instruct.operation == JUMPREL || instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO;
+}
+
+// returns true if [instruct] names a register, i.e. is one of the *REG instructions
+static bool isRegisterOp(const Instruction& instruct)
+{
+    return instruct.operation >= LOADREG && instruct.operation <= DIVREG;
+}
+
+// returns true if the jump at source index [i] has a non-zero argument and lands inside
+// the program or exactly one past its end
+static bool isValidJump(const Instruction& instruct, long i, long programSize)
+{
+    long target = i + instruct.argument;
+    return instruct.argument != 0 && target >= 0 && target <= programSize;
+}
+
+// tries to fuse the source instructions starting at [i] into a single superinstruction. Every
+// instruction after the first must exist and must not be a jump target, so jumps into the middle
+// of a fused region are never broken. On a match, fills in [entry] (with [offset] holding the
+// absolute source target of a trailing jump) and returns the number of instructions consumed.
+// Returns 0 if nothing matched
+int DecodedProgram::matchFusion(const Instruction* program, long i, const std::vector<char>& isTarget, DecodedInstruction& entry) const
+{
+    // number of instructions from [i] that may be fused (stops at the end or at a jump target)
+    long available = 1;
+    while (available < 4 && i + available < programSize && !isTarget[i + available])
+        ++available;
+
+    const Instruction& first = program[i];
+
+    // CLEAR; ADDCONST k  or  CLEAR; SUBCONST k
+    if (first.operation == CLEAR && available >= 2)
+    {
+        const Instruction& second = program[i + 1];
+        if (second.operation == ADDCONST)
+        {
+            entry = DecodedInstruction(OP_LOADCONST, second.argument);
+            return 2;
+        }
+        if (second.operation == SUBCONST && second.argument != LONG_MIN)
+        {
+            entry = DecodedInstruction(OP_LOADCONST, -second.argument);
+            return 2;
+        }
+        return 0;
+    }
+
+    // AT n; ADDCONST k; SET n  (or SUBCONST k), optionally followed by JUMPNZERO or JUMPREL. The same with
+    // LOADREG r; ...; STOREREG r on a valid register
+    bool onRegister = (first.operation == LOADREG && first.argument >= 0 && first.argument < GVM_REGISTERS);
+    if ((first.operation == AT || onRegister) && available >= 3)
+    {
+        const Instruction& second = program[i + 1];
+        const Instruction& third = program[i + 2];
+        if (third.operation != (onRegister ? STOREREG : SET) || third.argument != first.argument)
+            return 0;
+
+        long constant;
+        if (second.operation == ADDCONST)
+            constant = second.argument;
+        else if (second.operation == SUBCONST && second.argument != LONG_MIN)
+            constant = -second.argument;
+        else
+            return 0;
+
+        entry = DecodedInstruction(onRegister ? OP_INCREG : OP_INCMEM, first.argument, constant);
+
+        if (available >= 4)
+        {
+            const Instruction& fourth = program[i + 3];
+            if ((fourth.operation == JUMPNZERO || fourth.operation == JUMPREL) && isValidJump(fourth, i + 3, programSize))
+            {
+                if (onRegister)
+                    entry.op = (fourth.operation == JUMPNZERO) ? OP_INCREG_JNZ : OP_INCREG_JMP;
+                else
+                    entry.op = (fourth.operation == JUMPNZERO) ? OP_INCMEM_JNZ : OP_INCMEM_JMP;
+                entry.offset = i + 3 + fourth.argument;
+                return 4;
+            }
+        }
+        return 3;
+    }
+
+    return 0;
+}
+
+// validates and decodes the [count] instructions at [program], replacing any previous program
+// A jump of 0 is decoded to OP_BADJUMP and a jump whose target lies outside the program is
+// redirected to an OP_BADTARGET trap of its own, placed after OP_END and mapped back to the jump's
+// source instruction, as a register outside the register file is decoded to OP_BADREGISTER,
+// so the engine never has to check jump or register arguments while running. If [fuse] is true,
+// common instruction sequences are folded into superinstructions
+// If [bounds] is given, accesses it could not prove in bounds are preceded by an OP_GUARD entry; jumps
+// to such an access land on its guard
+void DecodedProgram::decode(const Instruction* program, int count, bool fuse, const BoundsAnalysis* bounds)
+{
+    clear();
+    programSize = count;
+
+    long endIndex = programSize;            // landing here ends the program
+    std::vector<size_t> badJumps;           // entries of the jumps whose target lies outside the program
+
+    // mark every instruction that some valid jump lands on
+    std::vector<char> isTarget(programSize + 2, 0);
+    for (long i = 0; i < programSize; ++i)
+    {
+        if (isJump(program[i]) && isValidJump(program[i], i, programSize))
+            isTarget[i + program[i].argument] = 1;
+    }
+
+    // first pass: emit handler entries, recording where each source instruction ended up.
+    // Jump entries temporarily hold their absolute source target in [offset]
+    std::vector<long> newIndex(programSize + 1, 0);
+    code.reserve(programSize + 1);
+    sourceIndex.reserve(programSize + 1);
+    for (long i = 0; i < programSize;)
+    {
+        newIndex[i] = code.size();
+
+        DecodedInstruction entry;
+        int consumed = fuse ? matchFusion(program, i, isTarget, entry) : 0;
+
+        // guard the access (for a superinstruction, the AT that starts it; its SET n follows with no merge
+        // in between, so is in bounds whenever the AT is)
+        bool guarded = false;
+        for (long j = i; bounds && j < i + std::max(consumed, 1); ++j)
+            guarded = guarded || bounds->needsCheck(j);
+        if (guarded)
+        {
+            code.push_back(DecodedInstruction(OP_GUARD, program[i].argument, BoundsAnalysis::requiredSize(program[i])));
+            sourceIndex.push_back(i);
+            ++guardCount;
+        }
+
+        if (consumed > 0)
+        {
+            code.push_back(entry);
+            sourceIndex.push_back(i);
+            for (int j = 1; j < consumed; ++j)
+                newIndex[i + j] = code.size() - 1;
+            fusedCount += consumed - 1;
+            i += consumed;
+            continue;
+        }
+
+        const Instruction& instruct = program[i];
+        if (isJump(instruct))
+        {   // validate the jump once here instead of on every execution
+            if (instruct.argument == 0)
+                entry = DecodedInstruction(OP_BADJUMP);
+            else if (isValidJump(instruct, i, programSize))
+                entry = DecodedInstruction(static_cast<DECODED_OP>(instruct.operation), instruct.argument, 0, i + instruct.argument);
+            else
+            {   // pointed at its trap once the traps are placed
+                entry = DecodedInstruction(static_cast<DECODED_OP>(instruct.operation), instruct.argument, 0, endIndex);
+                badJumps.push_back(code.size());
+            }
+        }
+        else if (isRegisterOp(instruct) && (instruct.argument < 0 || instruct.argument >= GVM_REGISTERS))
+        {   // likewise register indexes
+            entry = DecodedInstruction(OP_BADREGISTER);
+        }
+        else
+        {   // the plain instructions (and UNKNOWN_INSTRUCTION) map one-to-one onto their handlers
+            entry = DecodedInstruction(static_cast<DECODED_OP>(instruct.operation), instruct.argument);
+        }
+        code.push_back(entry);
+        sourceIndex.push_back(i);
+        ++i;
+    }
+
+    newIndex[endIndex] = code.size();
+    code.push_back(DecodedInstruction(OP_END));
+    sourceIndex.push_back(endIndex);
+    entryIndex.assign(newIndex.begin(), newIndex.begin() + endIndex + 1);
+
+    // second pass: turn the absolute source targets into relative offsets between handler entries
+    for (size_t e = 0; e < code.size(); ++e)
+    {
+        switch (code[e].op)
+        {
+            case OP_JUMPREL:
+            case OP_JUMPZERO:
+            case OP_JUMPNZERO:
+            case OP_INCMEM_JNZ:
+            case OP_INCMEM_JMP:
+            case OP_INCREG_JNZ:
+            case OP_INCREG_JMP:
+                code[e].offset = newIndex[code[e].offset] - static_cast<long>(e);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // a trap per out of range jump, so that the engine can report the jump that threw
+    for (size_t e : badJumps)
+    {
+        code[e].offset = static_cast<long>(code.size() - e);
+        code.push_back(DecodedInstruction(OP_BADTARGET));
+        sourceIndex.push_back(sourceIndex[e]);
+    }
+}
+
+// removes the decoded program
+void DecodedProgram::clear()
+{
+    code.clear();
+    entryIndex.clear();
+    sourceIndex.clear();
+    programSize = 0;
+    fusedCount = 0;
+    guardCount = 0;
+}
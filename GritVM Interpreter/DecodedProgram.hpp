@@ -0,0 +1,94 @@
+/***********************************************************************
+ * DecodedProgram.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the DecodedProgram class, which holds a
+ *              GritVM program that has been validated and pre-decoded at
+ *              load time into a flat array of handler entries. Used by the
+ *              threaded execution engine so no per-instruction checks have
+ *              to be repeated at run time.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef DECODEDPROGRAM_H
+#define DECODEDPROGRAM_H
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+#include "BoundsAnalysis.hpp"
+
+#include <vector>
+
+// Handler opcodes understood by the threaded engine. The first entries mirror
+// INSTRUCTION_SET one-to-one so a plain instruction decodes by a cast
+typedef enum _decoded_op {
+  OP_CLEAR,
+  OP_AT, OP_SET, OP_INSERT, OP_ERASE,
+  OP_ADDCONST, OP_SUBCONST, OP_MULCONST, OP_DIVCONST,
+  OP_ADDMEM, OP_SUBMEM, OP_MULMEM, OP_DIVMEM,
+  OP_JUMPREL, OP_JUMPZERO, OP_JUMPNZERO,
+  OP_NOOP, OP_HALT, OP_OUTPUT, OP_CHECKMEM,
+  OP_LOADREG, OP_STOREREG,
+  OP_ADDREG, OP_SUBREG, OP_MULREG, OP_DIVREG,
+  OP_UNKNOWN,
+
+  // Superinstructions produced by the fusion pass
+  OP_LOADCONST,   // CLEAR; ADDCONST k                      -> acc = k
+  OP_INCMEM,      // AT n; ADDCONST k; SET n                -> dataMem[n] += k, acc = dataMem[n]
+  OP_INCMEM_JNZ,  // AT n; ADDCONST k; SET n; JUMPNZERO j   -> OP_INCMEM, then jump if acc != 0
+  OP_INCMEM_JMP,  // AT n; ADDCONST k; SET n; JUMPREL j     -> OP_INCMEM, then jump
+  OP_INCREG,      // LOADREG r; ADDCONST k; STOREREG r      -> register r += k, acc = register r
+  OP_INCREG_JNZ,  // OP_INCREG, then JUMPNZERO j
+  OP_INCREG_JMP,  // OP_INCREG, then JUMPREL j
+
+  // Engine-only handlers
+  OP_GUARD,       // bounds check placed before an access BoundsAnalysis could not prove, throws if it fails
+  OP_BADJUMP,     // jump with an argument of 0, throws when reached
+  OP_BADTARGET,   // trap entry an out of range jump is pointed at, throws when reached
+  OP_BADREGISTER, // register instruction whose index is outside the register file, throws when reached
+  OP_END,         // sentinel placed one past the last instruction, ends the program
+
+  OP_COUNT        // number of handler opcodes, keep last
+} DECODED_OP;
+
+// A handler entry. [arg] is the instruction argument (the memory index for OP_INCMEM*, the register for OP_INCREG*),
+// [arg2] the constant of a superinstruction (the required memory size for OP_GUARD) and [offset] the
+// relative jump for jump handlers
+typedef struct _decoded_instruction {
+  DECODED_OP op; long arg; long arg2; long offset;
+
+  _decoded_instruction(DECODED_OP o = OP_END, long a = 0, long a2 = 0, long off = 0) : op(o), arg(a), arg2(a2), offset(off) {};
+} DecodedInstruction;
+
+class DecodedProgram
+{
+    private:
+        CustomVector<DecodedInstruction> code;                  // decoded handlers followed by OP_END and an OP_BADTARGET per bad jump
+        std::vector<long> entryIndex;                           // handler entry each source instruction (and the end) decodes to
+        std::vector<long> sourceIndex;                          // source instruction each handler entry starts at
+        int programSize;                                        // number of instructions in the source program
+        int fusedCount;                                         // number of source instructions folded into superinstructions
+        int guardCount;                                         // number of OP_GUARD entries inserted
+
+        int matchFusion(const Instruction* program, long i, const std::vector<char>& isTarget, DecodedInstruction& entry) const;
+
+    public:
+        DecodedProgram() : programSize(0), fusedCount(0), guardCount(0) {};
+
+        // validates and decodes [program], replacing any previous program. If [bounds] is given, an OP_GUARD
+        // entry is placed before every access it did not prove in bounds
+        void decode(const Instruction* program, int count, bool fuse = true, const BoundsAnalysis* bounds = nullptr);
+        void clear();                                           // removes the decoded program
+        int size() const { return programSize; };               // number of source instructions decoded
+        int entries() const { return programSize - fusedCount + guardCount; };  // number of handler entries the engine dispatches through
+        bool empty() const { return programSize == 0; };
+        const DecodedInstruction* entry() const { return &code[0]; };  // pointer to the first handler entry - only valid when !empty()
+
+        // translate between source instruction indexes and handler entry indexes, so a run can stop in one
+        // engine and resume in another. A source index inside a superinstruction does not start an entry
+        long entryOf(long source) const { return entryIndex[source]; };
+        long sourceOf(long entry) const { return sourceIndex[entry]; };
+        bool startsEntry(long source) const { return sourceIndex[entryIndex[source]] == source; };
+};
+
+#endif // DECODEDPROGRAM_H
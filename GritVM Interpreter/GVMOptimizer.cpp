@@ -0,0 +1,493 @@
+/***********************************************************************
+ * GVMOptimizer.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GVMOptimizer class, which
+ *              folds constants and removes dead code from GritVM programs.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GVMOptimizer.hpp"
+
+#include <climits>
+
+// What is known about the accumulator when an instruction is reached
+typedef enum _acc_state {
+  ACC_UNREACHED,    // no path reaches the instruction
+  ACC_KNOWN,        // the accumulator always holds [value]
+  ACC_VARYING       // the accumulator may hold different values
+} ACC_STATE;
+
+typedef struct _acc_value {
+  ACC_STATE state; long value;
+
+  _acc_value(ACC_STATE s = ACC_UNREACHED, long v = 0) : state(s), value(v) {};
+  bool operator==(const _acc_value& other) const { return state == other.state && (state != ACC_KNOWN || value == other.value); };
+} AccValue;
+
+// the value known where paths with [a] and [b] merge
+static AccValue meet(const AccValue& a, const AccValue& b)
+{
+    if (a.state == ACC_UNREACHED)
+        return b;
+    if (b.state == ACC_UNREACHED)
+        return a;
+    if (a.state == ACC_KNOWN && b.state == ACC_KNOWN && a.value == b.value)
+        return a;
+    return AccValue(ACC_VARYING);
+}
+
+// computes [acc] [op] [arg] into [result] for the *CONST instructions. Returns false if the operation
+// would overflow or divide by zero, in which case it must be left for the VM
+static bool foldArithmetic(INSTRUCTION_SET op, long acc, long arg, long& result)
+{
+    switch (op)
+    {
+        case ADDCONST:
+            if ((arg > 0 && acc > LONG_MAX - arg) || (arg < 0 && acc < LONG_MIN - arg))
+                return false;
+            result = acc + arg;
+            return true;
+        case SUBCONST:
+            if ((arg < 0 && acc > LONG_MAX + arg) || (arg > 0 && acc < LONG_MIN + arg))
+                return false;
+            result = acc - arg;
+            return true;
+        case MULCONST:
+        {
+            if (acc == 0 || arg == 0)
+            {
+                result = 0;
+                return true;
+            }
+            if ((acc == -1 && arg == LONG_MIN) || (arg == -1 && acc == LONG_MIN))
+                return false;
+            long product = static_cast<long>(static_cast<unsigned long>(acc) * static_cast<unsigned long>(arg));
+            if (product / arg != acc)
+                return false;
+            result = product;
+            return true;
+        }
+        case DIVCONST:
+            if (arg == 0 || (acc == LONG_MIN && arg == -1))
+                return false;
+            result = acc / arg;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// true if [instruct], reached with the accumulator [in], only changes the accumulator and can never fail, so it
+// can be removed or replaced freely. With checked arithmetic an overflow stops the run, so arithmetic on an
+// accumulator that is not known is only pure if no value can make it overflow
+static bool isPure(const Instruction& instruct, const AccValue& in)
+{
+    long arg = instruct.argument;
+    long result;
+    bool folds = in.state == ACC_KNOWN && foldArithmetic(instruct.operation, in.value, arg, result);
+    switch (instruct.operation)
+    {
+        case CLEAR:
+        case NOOP:
+            return true;
+        case ADDCONST:
+        case SUBCONST:
+            return arg == 0 || folds;
+        case MULCONST:
+            return arg == 0 || arg == 1 || folds;
+        case DIVCONST:
+            return (arg != 0 && arg != -1) || folds;
+        default:
+            return false;
+    }
+}
+
+// true if [instruct] leaves the accumulator as it was
+static bool isIdentity(const Instruction& instruct)
+{
+    long arg = instruct.argument;
+    switch (instruct.operation)
+    {
+        case NOOP:
+            return true;
+        case ADDCONST:
+        case SUBCONST:
+            return arg == 0;
+        case MULCONST:
+        case DIVCONST:
+            return arg == 1;
+        default:
+            return false;
+    }
+}
+
+// true if the jump at [i] has a non-zero argument and lands inside the program or one past its end
+static bool isValidJump(const std::vector<Instruction>& program, long i)
+{
+    long target = i + program[i].argument;
+    return program[i].argument != 0 && target >= 0 && target <= static_cast<long>(program.size());
+}
+
+// fills [next] with the instructions that may run after [i] (program.size() meaning the program ends) and
+// returns how many there are. HALT, UNKNOWN_INSTRUCTION and jumps that always throw have none
+static int successors(const std::vector<Instruction>& program, long i, long next[2])
+{
+    const Instruction& instruct = program[i];
+    int count = 0;
+    switch (instruct.operation)
+    {
+        case JUMPREL:
+            if (isValidJump(program, i))
+                next[count++] = i + instruct.argument;
+            return count;
+        case JUMPZERO:
+        case JUMPNZERO:
+            if (instruct.argument == 0)
+                return 0;
+            if (isValidJump(program, i))
+                next[count++] = i + instruct.argument;
+            next[count++] = i + 1;
+            return count;
+        case HALT:
+        case UNKNOWN_INSTRUCTION:
+            return 0;
+        default:
+            if (instruct.operation > DIVREG)
+                return 0;
+            next[count++] = i + 1;
+            return count;
+    }
+}
+
+// the accumulator after [instruct] runs with [in]
+static AccValue transfer(const Instruction& instruct, const AccValue& in)
+{
+    switch (instruct.operation)
+    {
+        case CLEAR:
+            return AccValue(ACC_KNOWN, 0);
+        case ADDCONST:
+        case SUBCONST:
+        case MULCONST:
+        case DIVCONST:
+        {
+            long result;
+            if (in.state == ACC_KNOWN && foldArithmetic(instruct.operation, in.value, instruct.argument, result))
+                return AccValue(ACC_KNOWN, result);
+            return AccValue(ACC_VARYING);
+        }
+        case AT:
+        case ADDMEM:
+        case SUBMEM:
+        case MULMEM:
+        case DIVMEM:
+        case LOADREG:
+        case ADDREG:
+        case SUBREG:
+        case MULREG:
+        case DIVREG:
+            return AccValue(ACC_VARYING);
+        default:
+            return in;
+    }
+}
+
+// forward constant propagation: fills [in] with the accumulator on reaching each instruction. A conditional
+// jump whose condition is known only flows to the branch it takes, so [in] also tells what is reachable
+static void propagate(const std::vector<Instruction>& program, std::vector<AccValue>& in)
+{
+    long count = static_cast<long>(program.size());
+    in.assign(count, AccValue());
+    std::vector<long> work;
+
+    if (count > 0)
+    {   // every run starts with the accumulator at 0
+        in[0] = AccValue(ACC_KNOWN, 0);
+        work.push_back(0);
+    }
+
+    while (!work.empty())
+    {
+        long i = work.back();
+        work.pop_back();
+
+        const Instruction& instruct = program[i];
+        AccValue out = transfer(instruct, in[i]);
+        long next[2];
+        int nextCount = successors(program, i, next);
+
+        if ((instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO) && instruct.argument != 0 && in[i].state == ACC_KNOWN)
+        {   // keep only the branch taken
+            bool taken = (instruct.operation == JUMPZERO) == (in[i].value == 0);
+            if (taken)
+                nextCount = isValidJump(program, i) ? 1 : 0;
+            else
+            {
+                next[0] = i + 1;
+                nextCount = 1;
+            }
+        }
+
+        for (int s = 0; s < nextCount; ++s)
+        {
+            if (next[s] >= count)
+                continue;
+            AccValue merged = meet(in[next[s]], out);
+            if (!(merged == in[next[s]]))
+            {
+                in[next[s]] = merged;
+                work.push_back(next[s]);
+            }
+        }
+    }
+}
+
+// true if [instruct] reads the accumulator
+static bool readsAcc(const Instruction& instruct)
+{
+    switch (instruct.operation)
+    {
+        case CLEAR:
+        case AT:
+        case LOADREG:
+        case ERASE:
+        case JUMPREL:
+        case NOOP:
+        case HALT:
+        case CHECKMEM:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// backward liveness of the accumulator over the reachable instructions: [liveOut] is 1 where the value
+// left by an instruction may still be read. It is observable once the program stops, so it is live at every exit
+static void liveness(const std::vector<Instruction>& program, const std::vector<AccValue>& in, std::vector<char>& liveOut)
+{
+    long count = static_cast<long>(program.size());
+    liveOut.assign(count, 0);
+    std::vector<char> liveIn(count, 0);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (long i = count - 1; i >= 0; --i)
+        {
+            if (in[i].state == ACC_UNREACHED)
+                continue;
+
+            long next[2];
+            int nextCount = successors(program, i, next);
+            char out = (nextCount == 0) ? 1 : 0;
+            for (int s = 0; s < nextCount; ++s)
+                out = out || next[s] >= count || liveIn[next[s]];
+
+            // a failing CHECKMEM ends the program, leaving the accumulator as it is
+            bool kills = program[i].operation == CLEAR || program[i].operation == AT || program[i].operation == LOADREG;
+            bool mayExit = program[i].operation == CHECKMEM;
+            char newIn = readsAcc(program[i]) || mayExit || (out && !kills);
+            if (out != liveOut[i] || newIn != liveIn[i])
+            {
+                liveOut[i] = out;
+                liveIn[i] = newIn;
+                changed = true;
+            }
+        }
+    }
+}
+
+// optimizes the [count] instructions at [program] into [out], see header
+OptimizeReport GVMOptimizer::optimize(const Instruction* program, int count, std::vector<Instruction>& out)
+{
+    OptimizeReport report;
+    report.before = count;
+    std::vector<Instruction> code(program, program + count);
+
+    // fold conditional jumps with a known condition, and jumps to the next instruction
+    std::vector<AccValue> in;
+    propagate(code, in);
+    for (long i = 0; i < count; ++i)
+    {
+        Instruction& instruct = code[i];
+        if (in[i].state == ACC_UNREACHED || instruct.argument == 0)
+            continue;
+        bool folded = false;
+        if ((instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO) && in[i].state == ACC_KNOWN)
+        {
+            bool taken = (instruct.operation == JUMPZERO) == (in[i].value == 0);
+            instruct = taken ? Instruction(JUMPREL, instruct.argument) : Instruction(NOOP);
+            folded = true;
+        }
+        if (instruct.operation == JUMPREL && instruct.argument == 1)
+        {
+            instruct = Instruction(NOOP);
+            folded = true;
+        }
+        if (folded)
+            ++report.foldedBranches;
+    }
+
+    // re-analyze the simplified control flow
+    propagate(code, in);
+    std::vector<char> liveOut;
+    liveness(code, in, liveOut);
+
+    // remove unreachable instructions and arithmetic nobody reads
+    std::vector<char> removed(count, 0);
+    for (long i = 0; i < count; ++i)
+    {
+        if (in[i].state == ACC_UNREACHED)
+        {
+            removed[i] = 1;
+            ++report.unreachable;
+        }
+        else if (isPure(code[i], in[i]) && !liveOut[i])
+        {   // becomes a NOOP, which the run pass below drops
+            code[i] = Instruction(NOOP);
+        }
+    }
+
+    // the values known on reaching each instruction no longer include the arithmetic just removed
+    propagate(code, in);
+
+    // runs of accumulator arithmetic must not span a jump target
+    std::vector<char> isTarget(count + 1, 0);
+    for (long i = 0; i < count; ++i)
+    {
+        if (!removed[i] && (code[i].operation == JUMPREL || code[i].operation == JUMPZERO || code[i].operation == JUMPNZERO)
+            && isValidJump(code, i))
+            isTarget[i + code[i].argument] = 1;
+    }
+
+    // what each source instruction becomes; a shortened run is placed at its first instruction
+    std::vector<std::vector<Instruction> > emitted(count);
+    for (long i = 0; i < count;)
+    {
+        if (removed[i] || !isPure(code[i], in[i]))
+        {
+            if (!removed[i])
+                emitted[i].push_back(code[i]);
+            ++i;
+            continue;
+        }
+
+        long start = i;
+        long last = -1;
+        std::vector<Instruction> kept;
+        for (; i < count && (i == start || !isTarget[i]) && (removed[i] || isPure(code[i], in[i])); ++i)
+        {
+            if (!removed[i])
+            {
+                last = i;
+                if (!isIdentity(code[i]))
+                    kept.push_back(code[i]);
+                else
+                    ++report.dead;
+            }
+        }
+
+        // a run with a constant result becomes the cheapest way to load that constant
+        AccValue result = (last >= 0) ? transfer(code[last], in[last]) : in[start];
+        if (result.state == ACC_KNOWN && !kept.empty())
+        {
+            std::vector<Instruction> load;     // stays empty if the accumulator already holds the result
+            long difference;
+            bool alreadyHeld = in[start].state == ACC_KNOWN && in[start].value == result.value;
+            if (alreadyHeld)
+                load.clear();
+            else if (result.value == 0)
+                load.push_back(Instruction(CLEAR));
+            else if (in[start].state == ACC_KNOWN && foldArithmetic(SUBCONST, result.value, in[start].value, difference))
+                load.push_back(Instruction(ADDCONST, difference));
+            else
+            {
+                load.push_back(Instruction(CLEAR));
+                load.push_back(Instruction(ADDCONST, result.value));
+            }
+
+            if (load.size() < kept.size())
+            {
+                kept = load;
+                ++report.foldedRuns;
+            }
+        }
+        emitted[start] = kept;
+    }
+
+    // a HALT at the very end does the same as running off the end, unless nothing else is left: an empty program
+    // loads WAITING and never runs, so a program that ran keeps one instruction
+    size_t left = 0;
+    for (long i = 0; i < count; ++i)
+        left += emitted[i].size();
+    for (long i = count - 1; i >= 0; --i)
+    {
+        if (emitted[i].empty())
+            continue;
+        if (emitted[i].back().operation == HALT && left > 1)
+        {
+            emitted[i].pop_back();
+            ++report.dead;
+        }
+        break;
+    }
+    if (left == 0 && count > 0)
+        emitted[0].push_back(Instruction(NOOP));
+
+    // lay the program out and retarget the jumps. A backward jump whose target range was emptied would become
+    // a jump of 0 (which throws), so a NOOP is kept at its target and the layout redone
+    std::vector<char> placeholder(count + 1, 0);
+    std::vector<long> newIndex(count + 1, 0);
+    bool again = true;
+    while (again)
+    {
+        again = false;
+        out.clear();
+        std::vector<long> jumpAt(count, -1);
+        for (long i = 0; i < count; ++i)
+        {
+            newIndex[i] = static_cast<long>(out.size());
+            if (placeholder[i])
+                out.push_back(Instruction(NOOP));
+            for (const Instruction& instruct : emitted[i])
+            {
+                if (instruct.operation == JUMPREL || instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO)
+                    jumpAt[i] = static_cast<long>(out.size());
+                out.push_back(instruct);
+            }
+        }
+        newIndex[count] = static_cast<long>(out.size());
+
+        for (long i = 0; i < count; ++i)
+        {
+            if (jumpAt[i] < 0 || code[i].argument == 0)
+                continue;
+            Instruction& jump = out[jumpAt[i]];
+            if (!isValidJump(code, i))
+            {   // keep it out of range, so it still throws
+                jump.argument = -(jumpAt[i] + 1);
+                continue;
+            }
+            long target = i + code[i].argument;
+            jump.argument = newIndex[target] - jumpAt[i];
+            if (jump.argument == 0)
+            {
+                placeholder[target] = 1;
+                again = true;
+            }
+        }
+    }
+
+    report.after = static_cast<int>(out.size());
+    return report;
+}
+
+// one line summary of the report
+std::string OptimizeReport::toString() const
+{
+    return std::to_string(before) + " -> " + std::to_string(after) + " instructions (unreachable " + std::to_string(unreachable)
+        + ", dead " + std::to_string(dead) + ", folded branches " + std::to_string(foldedBranches)
+        + ", folded runs " + std::to_string(foldedRuns) + ")";
+}
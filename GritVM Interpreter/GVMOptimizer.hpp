@@ -0,0 +1,74 @@
+/***********************************************************************
+ * GVMOptimizer.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GVMOptimizer class, a whole-program
+ *              optimizer that rewrites a GritVM program into an equivalent,
+ *              shorter one.
+ *
+ *              It builds the control flow graph of the program (relative
+ *              jumps, HALT, and jumps that throw having no successors) and
+ *              runs two analyses over it:
+ *                - constant propagation of the accumulator, following only
+ *                  the branch a constant condition takes, which also yields
+ *                  the reachable instructions
+ *                - liveness of the accumulator, backwards
+ *              and then:
+ *                - turns JUMPZERO/JUMPNZERO with a constant condition into
+ *                  a JUMPREL or removes them, and removes JUMPREL 1
+ *                - removes unreachable instructions
+ *                - removes accumulator arithmetic whose result is never read
+ *                  (e.g. a CLEAR right before an AT)
+ *                - replaces a straight-line run of accumulator arithmetic
+ *                  with a constant result by the shortest equivalent
+ *                  (nothing, CLEAR, ADDCONST or CLEAR; ADDCONST)
+ *                - removes NOOPs and identities (ADDCONST 0, MULCONST 1, ...)
+ *                  and a HALT at the very end
+ *              Jumps are retargeted to the new positions; jumps that throw
+ *              (argument 0 or target out of range) still throw. The result
+ *              is never empty for a non-empty program (an empty program
+ *              loads WAITING and never runs): a lone HALT is kept, and a
+ *              program with nothing left becomes a single NOOP.
+ *
+ *              Arithmetic is only folded or removed when it cannot overflow
+ *              or divide by zero, which for an accumulator that is not known
+ *              means for any value; other arithmetic is left for the VM to
+ *              execute. The optimized program leaves the same data memory,
+ *              output and accumulator whenever the program ends (off the
+ *              end, HALT or a failing CHECKMEM) and throws the same
+ *              exceptions; the accumulator left behind by an exception may
+ *              differ. That holds with checked arithmetic on as well: a run
+ *              that faults faults in the optimized program too, with the
+ *              same message, though getFault() gives the instruction's new
+ *              index.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GVMOPTIMIZER_H
+#define GVMOPTIMIZER_H
+
+#include "GritVMBase.hpp"
+
+#include <string>
+#include <vector>
+
+// What an optimize() call did. Counts are instructions
+typedef struct _optimize_report {
+  int before; int after;
+  int unreachable;      // removed because no path reaches them
+  int dead;             // accumulator arithmetic removed because its result is never read
+  int foldedBranches;   // conditional jumps with a constant condition, and JUMPREL 1
+  int foldedRuns;       // constant straight-line runs that were shortened
+
+  _optimize_report() : before(0), after(0), unreachable(0), dead(0), foldedBranches(0), foldedRuns(0) {};
+  std::string toString() const;
+} OptimizeReport;
+
+class GVMOptimizer
+{
+    public:
+        // writes the optimized form of the [count] instructions at [program] to [out], replacing its contents
+        static OptimizeReport optimize(const Instruction* program, int count, std::vector<Instruction>& out);
+};
+
+#endif // GVMOPTIMIZER_H
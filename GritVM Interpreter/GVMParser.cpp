@@ -0,0 +1,177 @@
+/***********************************************************************
+ * GVMParser.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GVMParser class, a zero-allocation
+ *              parser for GritVM source text.
+ *
+ *              See header file for the accepted syntax and class architecture
+ * *********************************************************************/
+
+#include "GVMParser.hpp"
+
+#include <charconv>
+#include <system_error>
+
+// true for the whitespace the parser skips within a line
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// returns the opcode spelled by [word], or UNKNOWN_INSTRUCTION. Dispatches on the length and then
+// the first character so at most a couple of comparisons are made per word
+INSTRUCTION_SET GVMParser::lookup(std::string_view word)
+{
+    switch (word.size())
+    {
+        case 2:
+            if (word == "AT") return AT;
+            break;
+        case 3:
+            if (word == "SET") return SET;
+            break;
+        case 4:
+            if (word[0] == 'N' && word == "NOOP") return NOOP;
+            if (word[0] == 'H' && word == "HALT") return HALT;
+            break;
+        case 5:
+            if (word[0] == 'C' && word == "CLEAR") return CLEAR;
+            if (word[0] == 'E' && word == "ERASE") return ERASE;
+            break;
+        case 6:
+            switch (word[0])
+            {
+                case 'I': if (word == "INSERT") return INSERT; break;
+                case 'A': if (word == "ADDMEM") return ADDMEM; break;
+                case 'S': if (word == "SUBMEM") return SUBMEM; break;
+                case 'M': if (word == "MULMEM") return MULMEM; break;
+                case 'D': if (word == "DIVMEM") return DIVMEM; break;
+                case 'O': if (word == "OUTPUT") return OUTPUT; break;
+            }
+            if (word[3] == 'R')
+            {
+                switch (word[0])
+                {
+                    case 'A': if (word == "ADDREG") return ADDREG; break;
+                    case 'S': if (word == "SUBREG") return SUBREG; break;
+                    case 'M': if (word == "MULREG") return MULREG; break;
+                    case 'D': if (word == "DIVREG") return DIVREG; break;
+                }
+            }
+            break;
+        case 7:
+            if (word[0] == 'J' && word == "JUMPREL") return JUMPREL;
+            if (word[0] == 'L' && word == "LOADREG") return LOADREG;
+            break;
+        case 8:
+            switch (word[0])
+            {
+                case 'A': if (word == "ADDCONST") return ADDCONST; break;
+                case 'S':
+                    if (word == "SUBCONST") return SUBCONST;
+                    if (word == "STOREREG") return STOREREG;
+                    break;
+                case 'M': if (word == "MULCONST") return MULCONST; break;
+                case 'D': if (word == "DIVCONST") return DIVCONST; break;
+                case 'J': if (word == "JUMPZERO") return JUMPZERO; break;
+                case 'C': if (word == "CHECKMEM") return CHECKMEM; break;
+            }
+            break;
+        case 9:
+            if (word == "JUMPNZERO") return JUMPNZERO;
+            break;
+    }
+    return UNKNOWN_INSTRUCTION;
+}
+
+// false for the instructions that ignore their argument, for which it may be left out
+bool GVMParser::takesArgument(INSTRUCTION_SET instruct)
+{
+    return !(instruct == CLEAR || instruct == NOOP || instruct == HALT || instruct == OUTPUT);
+}
+
+// parses [source] line by line, appending each instruction to [out]. Stops at the first malformed
+// line, describing it in [error], and returns false; returns true if the whole source was parsed
+bool GVMParser::parse(std::string_view source, CustomVector<Instruction>& out, ParseError& error)
+{
+    const char* p = source.data();
+    const char* end = p + source.size();
+    int lineNumber = 0;
+
+    while (p < end)
+    {
+        // bounds of the current line
+        const char* lineStart = p;
+        const char* lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n')
+            ++lineEnd;
+        p = (lineEnd < end) ? lineEnd + 1 : end;
+        ++lineNumber;
+
+        // skip leading whitespace, then blank and comment lines
+        const char* c = lineStart;
+        while (c < lineEnd && isBlank(*c))
+            ++c;
+        if (c == lineEnd || *c == '#')
+            continue;
+
+        // opcode
+        const char* wordStart = c;
+        while (c < lineEnd && !isBlank(*c) && *c != '#')
+            ++c;
+        INSTRUCTION_SET instruct = lookup(std::string_view(wordStart, c - wordStart));
+        if (instruct == UNKNOWN_INSTRUCTION)
+        {
+            error.line = lineNumber;
+            error.column = static_cast<int>(wordStart - lineStart) + 1;
+            error.message = "unknown instruction '" + std::string(wordStart, c - wordStart) + "'";
+            return false;
+        }
+
+        // argument, required unless the instruction ignores it
+        while (c < lineEnd && isBlank(*c))
+            ++c;
+        long arg = 0;
+        if (c == lineEnd || *c == '#')
+        {
+            if (takesArgument(instruct))
+            {
+                error.line = lineNumber;
+                error.column = static_cast<int>(c - lineStart) + 1;
+                error.message = "missing argument for " + GVMHelper::instructionToString(instruct);
+                return false;
+            }
+        }
+        else
+        {
+            // from_chars takes a '-' but not a '+', which is skipped here; a second sign ("+-5") is not an integer
+            const char* numberStart = (*c == '+') ? c + 1 : c;
+            std::from_chars_result result = { numberStart, std::errc::invalid_argument };
+            if (numberStart == c || numberStart == lineEnd || *numberStart != '-')
+                result = std::from_chars(numberStart, lineEnd, arg);
+            if (result.ec != std::errc())
+            {
+                error.line = lineNumber;
+                error.column = static_cast<int>(c - lineStart) + 1;
+                error.message = (result.ec == std::errc::result_out_of_range) ? "argument out of range" : "argument is not an integer";
+                return false;
+            }
+            c = result.ptr;
+        }
+
+        // nothing but whitespace or a comment may follow
+        while (c < lineEnd && isBlank(*c))
+            ++c;
+        if (c < lineEnd && *c != '#')
+        {
+            error.line = lineNumber;
+            error.column = static_cast<int>(c - lineStart) + 1;
+            error.message = "unexpected text after argument";
+            return false;
+        }
+
+        out.push_back(Instruction(instruct, arg));
+    }
+
+    return true;
+}
@@ -0,0 +1,48 @@
+/***********************************************************************
+ * GVMParser.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GVMParser class, a hand-rolled parser
+ *              for GritVM source text. It works on a std::string_view over
+ *              the whole file, recognizes opcodes by length and first
+ *              character, reads arguments with std::from_chars and does not
+ *              allocate while parsing. Malformed lines are reported with
+ *              their line and column instead of being read as 0.
+ *
+ *              Accepted syntax, one instruction per line:
+ *                  [whitespace] OPCODE [whitespace ARGUMENT] [whitespace] [# comment]
+ *              Blank lines and lines starting with '#' are skipped. CLEAR,
+ *              NOOP, HALT and OUTPUT take an optional argument; every other
+ *              instruction requires one.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GVMPARSER_H
+#define GVMPARSER_H
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+
+#include <string>
+#include <string_view>
+
+// Where and why parsing stopped. [line] and [column] are 1-based
+typedef struct _parse_error {
+  int line; int column; std::string message;
+
+  _parse_error() : line(0), column(0) {};
+  std::string toString() const { return std::to_string(line) + ":" + std::to_string(column) + ": " + message; };
+} ParseError;
+
+class GVMParser
+{
+    public:
+        // parses [source] and appends its instructions to [out]. Returns false and fills in [error]
+        // at the first malformed line; [out] then holds the instructions before it
+        static bool parse(std::string_view source, CustomVector<Instruction>& out, ParseError& error);
+
+        static INSTRUCTION_SET lookup(std::string_view word);   // UNKNOWN_INSTRUCTION if [word] is not an opcode
+        static bool takesArgument(INSTRUCTION_SET instruct);    // false for instructions whose argument is optional
+};
+
+#endif // GVMPARSER_H
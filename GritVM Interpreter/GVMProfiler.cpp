@@ -0,0 +1,260 @@
+/***********************************************************************
+ * GVMProfiler.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GVMProfiler class, which
+ *              collects execution counts and loop timings of GritVM runs.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GVMProfiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+// number of distinct opcodes, UNKNOWN_INSTRUCTION being the last
+static const int OPCODE_COUNT = UNKNOWN_INSTRUCTION + 1;
+
+// formats [seconds] with a fixed precision, so reports line up
+static std::string formatSeconds(double seconds)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6f", seconds);
+    return buffer;
+}
+
+// formats [part] as a percentage of [whole]
+static std::string formatPercent(unsigned long long part, unsigned long long whole)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f%%", whole ? 100.0 * part / whole : 0.0);
+    return buffer;
+}
+
+// starts a run of the [count] instructions at [code]; a different program than the last one starts a new profile
+void GVMProfiler::begin(const Instruction* code, long count)
+{
+    bool same = (static_cast<long>(program.size()) == count);
+    for (long i = 0; same && i < count; ++i)
+        same = (program[i].operation == code[i].operation && program[i].argument == code[i].argument);
+
+    if (!same)
+    {
+        clear();
+        program.assign(code, code + count);
+        executed.assign(count, 0);
+        taken.assign(count, 0);
+        notTaken.assign(count, 0);
+        findLoops();
+    }
+
+    ++runs;
+    inRun = true;
+    resume();
+}
+
+// stops the clock at the end of a slice, charging the time of the region still open
+void GVMProfiler::pause()
+{
+    charge(Clock::now());
+    currentLoop = -1;
+}
+
+// restarts the clock for the next slice of the run
+void GVMProfiler::resume()
+{
+    currentLoop = -1;
+    regionStart = Clock::now();
+}
+
+// ends a run: charges the time of the region still open and updates the loop totals
+void GVMProfiler::end()
+{
+    pause();
+    inRun = false;
+
+    for (ProfiledLoop& loop : loops)
+    {
+        loop.executed = 0;
+        loop.iterations = 0;
+        for (long i = loop.head; i <= loop.tail; ++i)
+        {
+            loop.executed += executed[i];
+            const Instruction& instruct = program[i];
+            bool jump = (instruct.operation == JUMPREL || instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO);
+            if (jump && i + instruct.argument == loop.head)
+                loop.iterations += taken[i];
+        }
+    }
+}
+
+// adds the time since [regionStart] to the loop execution is leaving, and restarts the clock
+void GVMProfiler::charge(Clock::time_point now)
+{
+    double seconds = std::chrono::duration<double>(now - regionStart).count();
+    if (currentLoop < 0)
+        outsideSeconds += seconds;
+    else
+        loops[currentLoop].seconds += seconds;
+    regionStart = now;
+}
+
+// finds the loops of the program: every valid backward jump closes a loop from its target to itself.
+// Jumps back to the same head extend one loop, and each instruction belongs to the smallest loop around it
+void GVMProfiler::findLoops()
+{
+    long count = static_cast<long>(program.size());
+    for (long i = 0; i < count; ++i)
+    {
+        const Instruction& instruct = program[i];
+        bool jump = (instruct.operation == JUMPREL || instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO);
+        long target = i + instruct.argument;
+        if (!jump || instruct.argument >= 0 || target < 0)
+            continue;
+
+        auto existing = std::find_if(loops.begin(), loops.end(), [&](const ProfiledLoop& l) { return l.head == target; });
+        if (existing != loops.end())
+            existing->tail = std::max(existing->tail, i);
+        else
+            loops.push_back(ProfiledLoop{target, i, 0, 0, 0.0});
+    }
+    std::sort(loops.begin(), loops.end(), [](const ProfiledLoop& a, const ProfiledLoop& b) { return a.head < b.head; });
+
+    loopOf.assign(count, -1);
+    for (long i = 0; i < count; ++i)
+    {
+        for (int l = 0; l < static_cast<int>(loops.size()); ++l)
+        {
+            if (i < loops[l].head || i > loops[l].tail)
+                continue;
+            if (loopOf[i] < 0 || loops[l].tail - loops[l].head < loops[loopOf[i]].tail - loops[loopOf[i]].head)
+                loopOf[i] = l;
+        }
+    }
+}
+
+// drops the profile and the program it belongs to
+void GVMProfiler::clear()
+{
+    program.clear();
+    executed.clear();
+    taken.clear();
+    notTaken.clear();
+    loops.clear();
+    loopOf.clear();
+    outsideSeconds = 0;
+    runs = 0;
+    currentLoop = -1;
+    inRun = false;
+}
+
+// returns the number of instructions executed over every run
+unsigned long long GVMProfiler::totalExecuted() const
+{
+    unsigned long long total = 0;
+    for (unsigned long long n : executed)
+        total += n;
+    return total;
+}
+
+// returns the report for a person: the [top] hottest loops and instructions, the opcode mix and every branch
+std::string GVMProfiler::textReport(int top) const
+{
+    unsigned long long total = totalExecuted();
+    double seconds = outsideSeconds;
+    for (const ProfiledLoop& loop : loops)
+        seconds += loop.seconds;
+
+    std::ostringstream out;
+    out << "GritVM profile: " << total << " instructions over " << runs << " run(s), "
+        << formatSeconds(seconds) << " s\n";
+
+    std::vector<int> loopOrder(loops.size());
+    for (int l = 0; l < static_cast<int>(loops.size()); ++l)
+        loopOrder[l] = l;
+    std::stable_sort(loopOrder.begin(), loopOrder.end(), [&](int a, int b) { return loops[a].executed > loops[b].executed; });
+    out << "\nHot loops:\n";
+    if (loops.empty())
+        out << "  (none)\n";
+    for (int n = 0; n < static_cast<int>(loopOrder.size()) && n < top; ++n)
+    {
+        const ProfiledLoop& loop = loops[loopOrder[n]];
+        out << "  [" << loop.head << "-" << loop.tail << "]  executed " << loop.executed << " (" << formatPercent(loop.executed, total)
+            << ")  iterations " << loop.iterations << "  self time " << formatSeconds(loop.seconds) << " s\n";
+    }
+    out << "  outside loops: self time " << formatSeconds(outsideSeconds) << " s\n";
+
+    std::vector<long> instrOrder(program.size());
+    for (long i = 0; i < static_cast<long>(program.size()); ++i)
+        instrOrder[i] = i;
+    std::stable_sort(instrOrder.begin(), instrOrder.end(), [&](long a, long b) { return executed[a] > executed[b]; });
+    out << "\nHot instructions:\n";
+    for (int n = 0; n < static_cast<int>(instrOrder.size()) && n < top && executed[instrOrder[n]] > 0; ++n)
+    {
+        long i = instrOrder[n];
+        out << "  " << i << ": " << GVMHelper::instructionToString(program[i].operation) << " " << program[i].argument
+            << "  " << executed[i] << " (" << formatPercent(executed[i], total) << ")\n";
+    }
+
+    unsigned long long perOpcode[OPCODE_COUNT] = {};
+    for (long i = 0; i < static_cast<long>(program.size()); ++i)
+        perOpcode[program[i].operation] += executed[i];
+    out << "\nOpcodes:\n";
+    for (int op = 0; op < OPCODE_COUNT; ++op)
+    {
+        if (perOpcode[op] > 0)
+            out << "  " << GVMHelper::instructionToString(static_cast<INSTRUCTION_SET>(op)) << "  " << perOpcode[op]
+                << " (" << formatPercent(perOpcode[op], total) << ")\n";
+    }
+
+    out << "\nBranches:\n";
+    for (long i = 0; i < static_cast<long>(program.size()); ++i)
+    {
+        INSTRUCTION_SET op = program[i].operation;
+        if (op == JUMPZERO || op == JUMPNZERO)
+            out << "  " << i << ": " << GVMHelper::instructionToString(op) << " " << program[i].argument
+                << "  taken " << taken[i] << "  not taken " << notTaken[i] << "\n";
+    }
+    return out.str();
+}
+
+// returns the whole profile as a JSON object
+std::string GVMProfiler::jsonReport() const
+{
+    std::ostringstream out;
+    out << "{\"runs\":" << runs << ",\"executed\":" << totalExecuted()
+        << ",\"outside_loop_seconds\":" << formatSeconds(outsideSeconds) << ",\"instructions\":[";
+    for (long i = 0; i < static_cast<long>(program.size()); ++i)
+    {
+        INSTRUCTION_SET op = program[i].operation;
+        out << (i ? "," : "") << "{\"index\":" << i << ",\"op\":\"" << GVMHelper::instructionToString(op)
+            << "\",\"arg\":" << program[i].argument << ",\"count\":" << executed[i];
+        if (op == JUMPREL || op == JUMPZERO || op == JUMPNZERO)
+            out << ",\"taken\":" << taken[i] << ",\"not_taken\":" << notTaken[i];
+        out << "}";
+    }
+
+    unsigned long long perOpcode[OPCODE_COUNT] = {};
+    for (long i = 0; i < static_cast<long>(program.size()); ++i)
+        perOpcode[program[i].operation] += executed[i];
+    out << "],\"opcodes\":{";
+    bool first = true;
+    for (int op = 0; op < OPCODE_COUNT; ++op)
+    {
+        if (perOpcode[op] == 0)
+            continue;
+        out << (first ? "" : ",") << "\"" << GVMHelper::instructionToString(static_cast<INSTRUCTION_SET>(op)) << "\":" << perOpcode[op];
+        first = false;
+    }
+
+    out << "},\"loops\":[";
+    for (int l = 0; l < static_cast<int>(loops.size()); ++l)
+    {
+        const ProfiledLoop& loop = loops[l];
+        out << (l ? "," : "") << "{\"head\":" << loop.head << ",\"tail\":" << loop.tail << ",\"executed\":" << loop.executed
+            << ",\"iterations\":" << loop.iterations << ",\"seconds\":" << formatSeconds(loop.seconds) << "}";
+    }
+    out << "]}";
+    return out.str();
+}
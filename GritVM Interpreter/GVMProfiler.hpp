@@ -0,0 +1,114 @@
+/***********************************************************************
+ * GVMProfiler.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GVMProfiler class, an execution
+ *              profiler for GritVM programs.
+ *
+ *              Attach a profiler to a GritContext (or GritVM) with
+ *              setProfiler() and every following run() is executed by an
+ *              instrumented copy of the switch engine that reports each
+ *              instruction to it. The profiler counts executions per
+ *              instruction and per opcode, taken and not-taken counts per
+ *              conditional jump, and wall time per loop. Loops are found
+ *              from backward jumps; time is charged to the innermost loop
+ *              running and the clock is only read when execution moves
+ *              between loops. Counts accumulate over runs of the same
+ *              program, so a batch can be profiled as a whole. A
+ *              time-sliced run (runFor(), runUntil(), GritScheduler)
+ *              counts as one run, and the time between its slices is not
+ *              charged.
+ *
+ *              Without a profiler attached nothing is instrumented: the
+ *              engines run exactly as before.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GVMPROFILER_H
+#define GVMPROFILER_H
+
+#include "GritVMBase.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// A loop found from a backward jump: instructions [head, tail], tail being the jump
+typedef struct _profiled_loop {
+  long head; long tail;
+  unsigned long long executed;    // instructions executed inside the loop, nested loops included
+  unsigned long long iterations;  // times a back edge of the loop was taken
+  double seconds;                 // wall time spent in the loop, nested loops excluded
+} ProfiledLoop;
+
+class GVMProfiler
+{
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        std::vector<Instruction> program;                       // copy of the program being profiled
+        std::vector<unsigned long long> executed;               // executions per instruction index
+        std::vector<unsigned long long> taken;                  // taken count per jump
+        std::vector<unsigned long long> notTaken;               // not-taken count per conditional jump
+        std::vector<ProfiledLoop> loops;                        // loops, ordered by head
+        std::vector<int> loopOf;                                // innermost loop of each instruction, -1 outside loops
+        double outsideSeconds;                                  // wall time outside every loop
+        unsigned long runs;
+
+        int currentLoop;                                        // loop the last instruction belonged to
+        Clock::time_point regionStart;                          // when execution entered currentLoop
+        bool inRun;                                             // between begin() and end()
+
+        void findLoops();
+        void charge(Clock::time_point now);                     // adds the time since regionStart to currentLoop
+
+    public:
+        GVMProfiler() : outsideSeconds(0), runs(0), currentLoop(-1), inRun(false) {};
+
+        // called by GritContext around a run. begin() starts a new profile if [code] is not the program
+        // being profiled, otherwise the counts keep accumulating
+        void begin(const Instruction* code, long count);
+        void end();
+
+        // called by GritContext around each slice of a time-sliced run after the first: the time between
+        // slices is not charged to any loop
+        void pause();
+        void resume();
+        bool running() const { return inRun; };                 // true between begin() and end()
+
+        // called by GritContext before instruction [index] executes with accumulator [acc]
+        void record(long index, long acc)
+        {
+            ++executed[index];
+            const Instruction& instruct = program[index];
+            if (instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO)
+            {
+                if ((acc == 0) == (instruct.operation == JUMPZERO))
+                    ++taken[index];
+                else
+                    ++notTaken[index];
+            }
+            else if (instruct.operation == JUMPREL)
+                ++taken[index];
+
+            if (loopOf[index] != currentLoop)
+            {
+                charge(Clock::now());
+                currentLoop = loopOf[index];
+            }
+        };
+
+        void clear();                                           // drops the profile and the program
+
+        unsigned long long totalExecuted() const;
+        unsigned long long executions(long index) const { return executed[index]; };
+        unsigned long long takenCount(long index) const { return taken[index]; };
+        unsigned long long notTakenCount(long index) const { return notTaken[index]; };
+        const std::vector<ProfiledLoop>& hotLoops() const { return loops; };    // loop statistics, ordered by head
+        unsigned long runCount() const { return runs; };
+
+        std::string textReport(int top = 10) const;             // human readable report of the [top] hottest loops and instructions
+        std::string jsonReport() const;                         // the full profile as JSON
+};
+
+#endif // GVMPROFILER_H
@@ -0,0 +1,135 @@
+/***********************************************************************
+ * GVMTracer.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GVMTracer class, which keeps
+ *              the most recent instructions of GritVM runs in a ring
+ *              buffer and writes and reads trace dumps.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GVMTracer.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const char GVMT_MAGIC[4] = { 'G', 'V', 'M', 'T' };
+
+// allocates a ring of [capacity] records, rounded up to a power of two so a slot is found with a mask
+GVMTracer::GVMTracer(size_t capacity) : mask(0), claimed(0), published(0)
+{
+    uint64_t slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+    mask = slots - 1;
+    words.reset(new std::atomic<uint64_t>[slots * 2]);
+    for (uint64_t i = 0; i < slots * 2; ++i)
+        words[i].store(0, std::memory_order_relaxed);
+}
+
+// drops every record
+void GVMTracer::clear()
+{
+    claimed.store(0, std::memory_order_relaxed);
+    published.store(0, std::memory_order_release);
+}
+
+// copies the records still in the ring to [out], oldest first, and returns the sequence number of the first.
+// Records the writer overwrote while they were being copied are dropped from the front
+uint64_t GVMTracer::snapshot(std::vector<TraceRecord>& out) const
+{
+    uint64_t end = published.load(std::memory_order_acquire);
+    uint64_t first = (end > mask + 1) ? end - (mask + 1) : 0;
+
+    std::vector<uint64_t> copied(static_cast<size_t>(end - first) * 2);
+    for (uint64_t sequence = first; sequence < end; ++sequence)
+    {
+        const std::atomic<uint64_t>* slot = &words[(sequence & mask) * 2];
+        copied[(sequence - first) * 2] = slot[0].load(std::memory_order_relaxed);
+        copied[(sequence - first) * 2 + 1] = slot[1].load(std::memory_order_relaxed);
+    }
+
+    // every record claimed by now may have overwritten the slot of the record a ring length before it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t started = claimed.load(std::memory_order_relaxed);
+    uint64_t valid = (started > mask + 1) ? started - (mask + 1) : 0;
+    uint64_t skip = (valid > first) ? valid - first : 0;
+    if (skip > end - first)
+        skip = end - first;
+
+    out.clear();
+    out.reserve(static_cast<size_t>(end - first - skip));
+    for (uint64_t i = skip; i < end - first; ++i)
+    {
+        TraceRecord record;
+        record.accumulator = static_cast<int64_t>(copied[i * 2]);
+        record.instruction = static_cast<int32_t>(copied[i * 2 + 1] & 0xffffffffu);
+        record.operation = static_cast<int32_t>(copied[i * 2 + 1] >> 32);
+        out.push_back(record);
+    }
+    return first + skip;
+}
+
+// writes the records still in the ring to [out] in the dump file layout (see header)
+void GVMTracer::dump(std::ostream& out) const
+{
+    std::vector<TraceRecord> records;
+    TraceHeader header;
+    std::memcpy(header.magic, GVMT_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.first = snapshot(records);
+    header.count = records.size();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!records.empty())
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TraceRecord));
+}
+
+// writes the records still in the ring to [filename]. Throws if the file cannot be written
+void GVMTracer::dump(const std::string& filename) const
+{
+    std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+    if (!output)
+        throw std::runtime_error(filename + " could not be opened");
+    dump(output);
+    if (!output)
+        throw std::runtime_error(filename + " could not be written");
+}
+
+// writes the error dump, if one is set. Called while a run is already failing, so a dump that cannot be
+// written is given up on rather than thrown over the run's own error
+void GVMTracer::stoppedWithError() const
+{
+    if (errorFile.empty())
+        return;
+    try
+    {
+        dump(errorFile);
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+// reads the dump file [filename] into [out] and returns the sequence number of its first record.
+// Throws if the file cannot be read or is not a trace dump of this version
+uint64_t GVMTracer::readDump(const std::string& filename, std::vector<TraceRecord>& out)
+{
+    std::ifstream input(filename, std::ios::binary);
+    if (!input)
+        throw std::runtime_error(filename + " could not be opened");
+
+    TraceHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, GVMT_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION)
+        throw std::runtime_error(filename + " is not a GritVM trace");
+
+    out.clear();
+    TraceRecord record;
+    while (out.size() < header.count && input.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        out.push_back(record);
+    if (out.size() != header.count)
+        throw std::runtime_error(filename + " is truncated");
+    return header.first;
+}
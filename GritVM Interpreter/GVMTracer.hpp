@@ -0,0 +1,112 @@
+/***********************************************************************
+ * GVMTracer.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GVMTracer class, an execution tracer
+ *              for GritVM programs.
+ *
+ *              Attach a tracer to a GritContext (or GritVM) with
+ *              setTracer() and every following run() is executed by an
+ *              instrumented copy of the switch engine that records, for
+ *              each instruction, its index, opcode and the accumulator it
+ *              started with. Records go into a fixed-size ring buffer that
+ *              keeps the most recent ones, so tracing a long job costs a
+ *              few stores per instruction and no allocation. The ring has
+ *              one writer (the thread running the context) and never
+ *              blocks it; snapshot() and dump() may be called from any
+ *              other thread while it runs, for example to look at a job
+ *              that seems stuck.
+ *
+ *              With setErrorDump() the trace is also written to a file
+ *              whenever a run stops ERRORED or with an exception. Dumps
+ *              are decoded by readDump() or the gvmtrace tool.
+ *
+ *              Dump file layout (little-endian):
+ *                  header:  char magic[4] = "GVMT", uint32 version,
+ *                           uint64 sequence number of the first record,
+ *                           uint64 record count
+ *                  records: oldest first, int64 accumulator,
+ *                           int32 instruction index, int32 opcode
+ *
+ *              Without a tracer attached nothing is instrumented: the
+ *              engines run exactly as before.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GVMTRACER_H
+#define GVMTRACER_H
+
+#include "GritVMBase.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One traced instruction, also the record layout of a dump file
+typedef struct _trace_record {
+  int64_t accumulator;      // the accumulator before the instruction ran
+  int32_t instruction;      // index of the instruction in the program
+  int32_t operation;        // its INSTRUCTION_SET opcode
+} TraceRecord;
+
+typedef struct _trace_header {
+  char magic[4]; uint32_t version; uint64_t first; uint64_t count;
+} TraceHeader;
+
+class GVMTracer
+{
+    private:
+        std::unique_ptr<std::atomic<uint64_t>[]> words;         // two words per slot: accumulator, index | opcode << 32
+        uint64_t mask;                                          // slot count - 1, the slot count being a power of two
+        std::atomic<uint64_t> claimed;                          // records the writer has started
+        std::atomic<uint64_t> published;                        // records the writer has finished
+        std::string errorFile;                                  // dump written when a run stops ERRORED, none if empty
+
+        GVMTracer(const GVMTracer&);                            // the ring is not copied
+        GVMTracer& operator=(const GVMTracer&);
+
+    public:
+        static const uint32_t VERSION = 1;
+        static const size_t DEFAULT_CAPACITY = 1 << 16;
+
+        explicit GVMTracer(size_t capacity = DEFAULT_CAPACITY); // keeps the last [capacity] records, rounded up to a power of two
+
+        // called by GritContext before instruction [index] with opcode [op] executes with accumulator [acc].
+        // The claim is made visible before the slot is overwritten, so a concurrent snapshot() can tell
+        // which of the records it copied may have been overwritten under it
+        void record(long index, INSTRUCTION_SET op, long acc)
+        {
+            uint64_t sequence = published.load(std::memory_order_relaxed);
+            claimed.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::atomic<uint64_t>* slot = &words[(sequence & mask) * 2];
+            slot[0].store(static_cast<uint64_t>(acc), std::memory_order_relaxed);
+            slot[1].store(static_cast<uint32_t>(index) | (static_cast<uint64_t>(op) << 32), std::memory_order_relaxed);
+            published.store(sequence + 1, std::memory_order_release);
+        };
+
+        // called by GritContext when a traced run stops ERRORED or with an exception: writes the error dump, if set
+        void stoppedWithError() const;
+
+        size_t capacity() const { return static_cast<size_t>(mask + 1); };
+        uint64_t totalRecorded() const { return published.load(std::memory_order_acquire); };
+        void clear();                                           // drops every record; not while a traced run is going
+
+        // copies the records still in the ring to [out], oldest first, and returns the sequence number of the first
+        uint64_t snapshot(std::vector<TraceRecord>& out) const;
+        void dump(std::ostream& out) const;                     // writes snapshot() in the dump file layout
+        void dump(const std::string& filename) const;           // throws if the file cannot be written
+
+        void setErrorDump(const std::string& filename) { errorFile = filename; };  // "" turns the error dump off
+        const std::string& getErrorDump() const { return errorFile; };
+
+        // reads a dump file into [out], returns the sequence number of its first record. Throws if it cannot be
+        // read or is not a trace dump
+        static uint64_t readDump(const std::string& filename, std::vector<TraceRecord>& out);
+};
+
+#endif // GVMTRACER_H
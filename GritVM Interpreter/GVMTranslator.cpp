@@ -0,0 +1,329 @@
+/***********************************************************************
+ * GVMTranslator.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GVMTranslator class, which
+ *              promotes the data memory cells of GritVM loops to registers.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GVMTranslator.hpp"
+#include "BoundsAnalysis.hpp"
+
+#include <algorithm>
+#include <map>
+
+// register that holds the accumulator while promoted cells are loaded or stored
+static const long SAVE_REGISTER = GVM_REGISTERS - 1;
+
+// A loop being translated: source instructions [start, end], the cells it keeps in registers (cell i in
+// register i) and which of them it writes
+typedef struct _loop_region {
+  long start; long end;
+  std::vector<long> cells;
+  std::vector<char> dirty;
+
+  _loop_region(long s = 0, long e = 0) : start(s), end(e) {};
+  bool contains(long i) const { return i >= start && i <= end; };
+  bool writesBack() const { return std::find(dirty.begin(), dirty.end(), 1) != dirty.end(); };
+} LoopRegion;
+
+// What an emitted jump's argument must reach once the layout is known
+typedef enum _fixup_kind {
+  TO_ENTRY,         // where control entering source instruction [index] from outside its loop lands
+  TO_BODY,          // source instruction [index] inside its loop, past the loop's loads
+  TO_STUB,          // exit stub [index]
+  TO_NOWHERE        // a target outside the program, which must stay outside it so the jump still throws
+} FIXUP_KIND;
+
+typedef struct _jump_fixup {
+  long position; FIXUP_KIND kind; long index;
+} JumpFixup;
+
+// returns true if [instruct] is a relative jump
+static bool isJump(const Instruction& instruct)
+{
+    return instruct.operation == JUMPREL || instruct.operation == JUMPZERO || instruct.operation == JUMPNZERO;
+}
+
+// true if the jump at [i] has a non-zero argument and lands inside the program or one past its end
+static bool isValidJump(const Instruction* program, long i, long count)
+{
+    long target = i + program[i].argument;
+    return program[i].argument != 0 && target >= 0 && target <= count;
+}
+
+// returns the register form of memory instruction [op], or UNKNOWN_INSTRUCTION if it has none
+static INSTRUCTION_SET registerForm(INSTRUCTION_SET op)
+{
+    switch (op)
+    {
+        case AT:        return LOADREG;
+        case SET:       return STOREREG;
+        case ADDMEM:    return ADDREG;
+        case SUBMEM:    return SUBREG;
+        case MULMEM:    return MULREG;
+        case DIVMEM:    return DIVREG;
+        default:        return UNKNOWN_INSTRUCTION;
+    }
+}
+
+// fills in [region]'s cells if the loop it spans can be translated (see header), returns false otherwise
+static bool planRegion(const Instruction* program, long count, const BoundsAnalysis& bounds, LoopRegion& region)
+{
+    long cellsAtEntry = bounds.minimumSize(region.start);
+    if (cellsAtEntry < 0)
+        return false;
+
+    // nothing inside may move cells, resize memory or end the program without passing an exit
+    std::map<long, int> uses;
+    for (long i = region.start; i <= region.end; ++i)
+    {
+        INSTRUCTION_SET op = program[i].operation;
+        if (op == INSERT || op == ERASE || op == CHECKMEM || op < CLEAR || op >= LOADREG)
+            return false;
+        long cell = program[i].argument;
+        if (registerForm(op) != UNKNOWN_INSTRUCTION && cell >= 0 && cell < cellsAtEntry)
+            ++uses[cell];
+    }
+
+    // the only way in is the first instruction
+    for (long i = 0; i < count; ++i)
+    {
+        if (region.contains(i) || !isJump(program[i]) || !isValidJump(program, i, count))
+            continue;
+        long target = i + program[i].argument;
+        if (target > region.start && target <= region.end)
+            return false;
+    }
+
+    // the most used cells, used at least twice, one register kept back for the accumulator
+    std::vector<std::pair<int, long> > ranked;
+    for (const std::pair<const long, int>& use : uses)
+    {
+        if (use.second >= 2)
+            ranked.push_back(std::make_pair(-use.second, use.first));
+    }
+    std::sort(ranked.begin(), ranked.end());
+    for (size_t r = 0; r < ranked.size() && static_cast<long>(r) < SAVE_REGISTER; ++r)
+        region.cells.push_back(ranked[r].second);
+    if (region.cells.empty())
+        return false;
+
+    region.dirty.assign(region.cells.size(), 0);
+    for (long i = region.start; i <= region.end; ++i)
+    {
+        if (program[i].operation != SET)
+            continue;
+        std::vector<long>::const_iterator found = std::find(region.cells.begin(), region.cells.end(), program[i].argument);
+        if (found != region.cells.end())
+            region.dirty[found - region.cells.begin()] = 1;
+    }
+    return true;
+}
+
+// appends the loads of [region]'s cells into their registers, keeping the accumulator
+static void emitLoads(const LoopRegion& region, std::vector<Instruction>& out)
+{
+    out.push_back(Instruction(STOREREG, SAVE_REGISTER));
+    for (size_t r = 0; r < region.cells.size(); ++r)
+    {
+        out.push_back(Instruction(AT, region.cells[r]));
+        out.push_back(Instruction(STOREREG, static_cast<long>(r)));
+    }
+    out.push_back(Instruction(LOADREG, SAVE_REGISTER));
+}
+
+// appends the stores of [region]'s written cells back to data memory, keeping the accumulator
+static void emitStores(const LoopRegion& region, std::vector<Instruction>& out)
+{
+    out.push_back(Instruction(STOREREG, SAVE_REGISTER));
+    for (size_t r = 0; r < region.cells.size(); ++r)
+    {
+        if (!region.dirty[r])
+            continue;
+        out.push_back(Instruction(LOADREG, static_cast<long>(r)));
+        out.push_back(Instruction(SET, region.cells[r]));
+    }
+    out.push_back(Instruction(LOADREG, SAVE_REGISTER));
+}
+
+// translates the [count] instructions at [program] into [out], see header
+TranslateReport GVMTranslator::toRegisters(const Instruction* program, int count, std::vector<Instruction>& out)
+{
+    TranslateReport report;
+    report.before = count;
+    out.assign(program, program + count);
+
+    // registers the program already uses cannot be handed out
+    for (long i = 0; i < count; ++i)
+    {
+        if (program[i].operation >= LOADREG && program[i].operation <= DIVREG)
+        {
+            report.after = count;
+            return report;
+        }
+    }
+
+    BoundsAnalysis bounds;
+    bounds.analyze(program, count);
+
+    // every backward jump closes a loop; take the widest that can be translated, then narrower ones around them
+    std::vector<LoopRegion> candidates;
+    for (long i = 0; i < count; ++i)
+    {
+        if (isJump(program[i]) && program[i].argument < 0 && isValidJump(program, i, count))
+            candidates.push_back(LoopRegion(i + program[i].argument, i));
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const LoopRegion& a, const LoopRegion& b) {
+        return a.end - a.start > b.end - b.start;
+    });
+
+    std::vector<LoopRegion> regions;
+    std::vector<long> regionOf(count, -1);
+    for (LoopRegion& candidate : candidates)
+    {
+        bool overlaps = false;
+        for (long i = candidate.start; i <= candidate.end; ++i)
+            overlaps = overlaps || regionOf[i] >= 0;
+        if (overlaps || !planRegion(program, count, bounds, candidate))
+            continue;
+        for (long i = candidate.start; i <= candidate.end; ++i)
+            regionOf[i] = static_cast<long>(regions.size());
+        regions.push_back(candidate);
+    }
+    if (regions.empty())
+    {
+        report.after = count;
+        return report;
+    }
+
+    // lay out the program, loops with their loads in front and their exits behind them. Jump arguments are
+    // filled in once every position is known
+    out.clear();
+    std::vector<long> entryPos(count + 1, 0);
+    std::vector<long> bodyPos(count + 1, 0);
+    std::vector<long> stubPos;
+    std::vector<JumpFixup> fixups;
+
+    // copies jump [i], bound to [kind] [index]; jumps of 0 are copied as they are and still throw
+    auto emitJump = [&](long i, FIXUP_KIND kind, long index) {
+        if (program[i].argument != 0)
+            fixups.push_back(JumpFixup{static_cast<long>(out.size()), kind, index});
+        out.push_back(program[i]);
+    };
+
+    for (long s = 0; s < count;)
+    {
+        if (regionOf[s] < 0)
+        {
+            entryPos[s] = bodyPos[s] = static_cast<long>(out.size());
+            if (isJump(program[s]))
+                emitJump(s, isValidJump(program, s, count) ? TO_ENTRY : TO_NOWHERE, s + program[s].argument);
+            else
+                out.push_back(program[s]);
+            ++s;
+            continue;
+        }
+
+        const LoopRegion& region = regions[regionOf[s]];
+        bool writesBack = region.writesBack();
+        std::vector<long> exitTargets;      // source target of each exit stub, count + 1 for HALT
+
+        // returns the exit stub leaving the loop for [target]
+        auto stubFor = [&](long target) {
+            std::vector<long>::iterator found = std::find(exitTargets.begin(), exitTargets.end(), target);
+            if (found != exitTargets.end())
+                return static_cast<long>(stubPos.size() + (found - exitTargets.begin()));
+            exitTargets.push_back(target);
+            return static_cast<long>(stubPos.size() + exitTargets.size() - 1);
+        };
+
+        entryPos[region.start] = static_cast<long>(out.size());
+        emitLoads(region, out);
+        for (long i = region.start; i <= region.end; ++i)
+        {
+            bodyPos[i] = static_cast<long>(out.size());
+            if (i != region.start)
+                entryPos[i] = bodyPos[i];
+
+            const Instruction& instruct = program[i];
+            std::vector<long>::const_iterator cell = std::find(region.cells.begin(), region.cells.end(), instruct.argument);
+            if (registerForm(instruct.operation) != UNKNOWN_INSTRUCTION && cell != region.cells.end())
+            {
+                out.push_back(Instruction(registerForm(instruct.operation), cell - region.cells.begin()));
+                ++report.rewritten;
+            }
+            else if (isJump(instruct))
+            {
+                long target = i + instruct.argument;
+                if (!isValidJump(program, i, count))
+                    emitJump(i, TO_NOWHERE, target);
+                else if (region.contains(target))
+                    emitJump(i, TO_BODY, target);
+                else
+                    emitJump(i, writesBack ? TO_STUB : TO_ENTRY, writesBack ? stubFor(target) : target);
+            }
+            else if (instruct.operation == HALT && writesBack)
+            {
+                fixups.push_back(JumpFixup{static_cast<long>(out.size()), TO_STUB, stubFor(count + 1)});
+                out.push_back(Instruction(JUMPREL, 0));
+            }
+            else
+                out.push_back(instruct);
+        }
+
+        // falling out of the loop stores its cells and skips the exit stubs
+        if (writesBack)
+        {
+            bool fallsOut = program[region.end].operation != JUMPREL;
+            if (fallsOut)
+                emitStores(region, out);
+            if (fallsOut && !exitTargets.empty())
+            {
+                fixups.push_back(JumpFixup{static_cast<long>(out.size()), TO_ENTRY, region.end + 1});
+                out.push_back(Instruction(JUMPREL, 0));
+            }
+            for (long target : exitTargets)
+            {
+                stubPos.push_back(static_cast<long>(out.size()));
+                emitStores(region, out);
+                if (target > count)
+                    out.push_back(Instruction(HALT));
+                else
+                {
+                    fixups.push_back(JumpFixup{static_cast<long>(out.size()), TO_ENTRY, target});
+                    out.push_back(Instruction(JUMPREL, 0));
+                }
+            }
+        }
+
+        ++report.loops;
+        report.promoted += static_cast<int>(region.cells.size());
+        s = region.end + 1;
+    }
+    entryPos[count] = bodyPos[count] = static_cast<long>(out.size());
+
+    for (const JumpFixup& fix : fixups)
+    {
+        long target;
+        switch (fix.kind)
+        {
+            case TO_ENTRY:  target = entryPos[fix.index]; break;
+            case TO_BODY:   target = bodyPos[fix.index]; break;
+            case TO_STUB:   target = stubPos[fix.index]; break;
+            default:        target = -1; break;     // before the first instruction
+        }
+        out[fix.position].argument = target - fix.position;
+    }
+
+    report.after = static_cast<int>(out.size());
+    return report;
+}
+
+// one line summary of the report
+std::string TranslateReport::toString() const
+{
+    return std::to_string(before) + " -> " + std::to_string(after) + " instructions (loops " + std::to_string(loops)
+        + ", cells promoted " + std::to_string(promoted) + ", accesses rewritten " + std::to_string(rewritten) + ")";
+}
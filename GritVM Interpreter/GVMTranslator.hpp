@@ -0,0 +1,62 @@
+/***********************************************************************
+ * GVMTranslator.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GVMTranslator class, which lowers a
+ *              single-accumulator GritVM program into register form: the
+ *              data memory cells a loop uses most are kept in registers for
+ *              the duration of the loop, so its AT, SET and *MEM
+ *              instructions on them become LOADREG, STOREREG and *REG.
+ *
+ *              A loop (the instructions from the target of a backward jump
+ *              up to the jump) is translated when:
+ *                - it contains no INSERT, ERASE or CHECKMEM, so cells keep
+ *                  their index and the memory its size inside it
+ *                - no jump from outside lands inside it, except on its
+ *                  first instruction
+ *                - BoundsAnalysis proves the cells it promotes exist
+ *                  whenever the loop is entered
+ *              Up to GVM_REGISTERS - 1 cells the loop accesses at least
+ *              twice are promoted (the last register saves the accumulator
+ *              while cells are loaded or stored). Entering the loop loads
+ *              them; every way out of it (falling out, jumping out or HALT)
+ *              stores the ones it writes back to data memory first.
+ *              Overlapping loops are translated outermost first. A program
+ *              that already uses registers is left as it is.
+ *
+ *              The translated program leaves the same data memory, output
+ *              and accumulator whenever the program ends and throws the
+ *              same exceptions, but the data memory left behind by an
+ *              exception or arithmetic fault inside a translated loop, or
+ *              seen between time-sliced runs, may not hold the promoted
+ *              cells' latest values (they are in the registers).
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GVMTRANSLATOR_H
+#define GVMTRANSLATOR_H
+
+#include "GritVMBase.hpp"
+
+#include <string>
+#include <vector>
+
+// What a toRegisters() call did. Counts are instructions unless noted
+typedef struct _translate_report {
+  int before; int after;
+  int loops;            // loops translated
+  int promoted;         // cells kept in registers, summed over the loops
+  int rewritten;        // memory accesses that became register instructions
+
+  _translate_report() : before(0), after(0), loops(0), promoted(0), rewritten(0) {};
+  std::string toString() const;
+} TranslateReport;
+
+class GVMTranslator
+{
+    public:
+        // writes the register form of the [count] instructions at [program] to [out], replacing its contents
+        static TranslateReport toRegisters(const Instruction* program, int count, std::vector<Instruction>& out);
+};
+
+#endif // GVMTRANSLATOR_H
@@ -0,0 +1,139 @@
+/***********************************************************************************
+ * GapBuffer.hpp
+ * Author: Matthew Sumpter
+ * Description: Template file for the GapBuffer ADT class, an alternative data
+ *              memory for GritVM programs that INSERT and ERASE heavily.
+ *
+ *              The elements live in one array with a hole (the gap) at the
+ *              last edit position:
+ *
+ *                  [ 0 .. gapStart )  gap  [ gapEnd .. capacity )
+ *
+ *              INSERT and ERASE at the gap are O(1); an edit elsewhere first
+ *              moves the gap there, which costs the distance moved rather
+ *              than the whole tail. Programs that build or consume a list at
+ *              one position (the common GritVM pattern) therefore run in O(1)
+ *              per edit instead of O(n). Indexing ([] for AT/SET) is one
+ *              compare more than CustomVector.
+ *
+ *              Only trivially copyable elements are supported, since the gap
+ *              is moved with memmove.
+ * *********************************************************************************/
+#ifndef GAPBUFFER_H
+#define GAPBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+template <typename E>
+class GapBuffer
+{
+    static_assert(std::is_trivially_copyable<E>::value, "GapBuffer elements must be trivially copyable");
+
+    private:
+        size_t capacity;             // current array size, including the gap
+        size_t gapStart;             // index of the first unused slot; also the logical index of the gap
+        size_t gapEnd;               // index of the first used slot after the gap
+        E* array;
+
+        size_t gapSize() const { return gapEnd - gapStart; };
+
+        // moves the gap so it starts at logical index [index], shifting only the elements in between
+        void moveGap(size_t index)
+        {
+            if (index < gapStart)
+            {   // elements [index, gapStart) move to the far side of the gap
+                size_t count = gapStart - index;
+                std::memmove(static_cast<void*>(array + gapEnd - count), static_cast<const void*>(array + index), count * sizeof(E));
+                gapStart -= count;
+                gapEnd -= count;
+            }
+            else if (index > gapStart)
+            {   // elements after the gap, up to logical [index], move to its near side
+                size_t count = index - gapStart;
+                std::memmove(static_cast<void*>(array + gapStart), static_cast<const void*>(array + gapEnd), count * sizeof(E));
+                gapStart += count;
+                gapEnd += count;
+            }
+        };
+
+        // reallocates to a capacity of at least [N], doubling so repeated growth is amortized O(1). The gap
+        // keeps its logical position and absorbs all of the new space
+        void grow(size_t N)
+        {
+            size_t newCapacity = std::max(N, std::max<size_t>(8, 2 * capacity));
+            E* B = static_cast<E*>(::operator new(newCapacity * sizeof(E)));
+            size_t tail = capacity - gapEnd;
+            if (gapStart > 0)
+                std::memcpy(static_cast<void*>(B), static_cast<const void*>(array), gapStart * sizeof(E));
+            if (tail > 0)
+                std::memcpy(static_cast<void*>(B + newCapacity - tail), static_cast<const void*>(array + gapEnd), tail * sizeof(E));
+            ::operator delete(array);
+            array = B;
+            gapEnd = newCapacity - tail;
+            capacity = newCapacity;
+        };
+
+        GapBuffer(const GapBuffer&);
+        GapBuffer& operator=(const GapBuffer&);
+
+    public:
+        GapBuffer() : capacity(0), gapStart(0), gapEnd(0), array(nullptr) {};
+        ~GapBuffer() { ::operator delete(array); };
+
+        size_t size() const { return capacity - gapSize(); };           // number of elements stored
+        bool empty() const { return size() == 0; };
+
+        // element at logical index [i] - no error checking
+        E& operator[](size_t i) { return array[(i < gapStart) ? i : i + gapSize()]; };
+        const E& operator[](size_t i) const { return array[(i < gapStart) ? i : i + gapSize()]; };
+
+        // inserts element [e] at logical position [arg]
+        void insert(long arg, const E& e)
+        {
+            E value(e);     // [e] may live in this buffer
+            if (gapStart == gapEnd)
+                grow(capacity + 1);
+            moveGap(static_cast<size_t>(arg));
+            array[gapStart++] = value;
+        };
+
+        // erases the element at logical position [arg]
+        void erase(long arg)
+        {
+            moveGap(static_cast<size_t>(arg));
+            ++gapEnd;
+        };
+
+        // replaces the contents with the [count] elements at [first], leaving the gap at the end
+        void assign(const E* first, size_t count)
+        {
+            clear();
+            if (capacity < count)
+                grow(count);
+            if (count > 0)
+                std::memcpy(static_cast<void*>(array), static_cast<const void*>(first), count * sizeof(E));
+            gapStart = count;
+        };
+
+        // copies the elements, in logical order, to [out], which must have room for size() elements
+        void copyTo(E* out) const
+        {
+            if (gapStart > 0)
+                std::memcpy(static_cast<void*>(out), static_cast<const void*>(array), gapStart * sizeof(E));
+            if (capacity > gapEnd)
+                std::memcpy(static_cast<void*>(out + gapStart), static_cast<const void*>(array + gapEnd), (capacity - gapEnd) * sizeof(E));
+        };
+
+        // erases every element, capacity is kept
+        void clear()
+        {
+            gapStart = 0;
+            gapEnd = capacity;
+        };
+};
+
+#endif // GAPBUFFER_H
@@ -0,0 +1,700 @@
+/***********************************************************************
+ * GritContext.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GritContext class, which holds
+ *              the execution state of a GritVM program and interprets it
+ *              with the switch engine, or hands it to the threaded or JIT
+ *              engine.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GritContext.hpp"
+#include "CustomVector.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+
+// moves the program counter by [offset] instructions (CAN be negative). Landing one past the last
+// instruction ends the program; any other target outside the instruction memory is an error
+void GritContext::jump(long offset)
+{
+    long target = programCounter + offset;
+    if (target < 0 || target > program->size())
+        throw std::out_of_range("Invalid Jump Command. Target is outside of instruction memory");
+    programCounter = target;
+}
+
+// returns register [index]; any index outside the register file is an error
+long& GritContext::reg(long index)
+{
+    if (index < 0 || index >= GVM_REGISTERS)
+        throw std::out_of_range("Invalid Register. Index is outside of the register file");
+    return registers[index];
+}
+
+// stops the run ERRORED at [instruction], an arithmetic instruction that could not be applied to the accumulator
+// with [operand], its constant or memory value, and records why in fault
+void GritContext::raiseFault(long instruction, long operand)
+{
+    INSTRUCTION_SET operation = program->data()[instruction].operation;
+    bool division = (operation == DIVCONST || operation == DIVMEM || operation == DIVREG);
+    fault.instruction = instruction;
+    fault.message = (division && operand == 0) ? "Division by zero" : "Arithmetic overflow in " + GVMHelper::instructionToString(operation);
+    programCounter = instruction;
+    machineStatus = ERRORED;
+}
+
+// takes Instruction object [instruct] as parameter, evaluates it against data memory [memory] and alters data members as necessary
+// [memory] is dataMem, gapMem or pagedMem, depending on the memory layout. The [Checked] instantiation faults on arithmetic
+// overflow and division by zero (see raiseFault())
+template <bool Checked, typename Memory>
+void GritContext::evaluateInstruction(const Instruction& instruct, Memory& memory)
+{
+    long arg = instruct.argument;  // capture argument variable
+    const Memory& cells = memory;  // reads go through the const [], which leaves a shared PagedMemory page shared
+
+    // each case carries out a potential instruction operation
+    switch (instruct.operation)
+    {
+        case CLEAR:
+        {   // set accumulator to 0, advance 1 instruction
+            accumulator = 0;
+            ++programCounter;
+            break;
+        }
+        case AT:
+        {   // Sets the accumulator to the value at dataMem[arg], advance 1 instruction
+            accumulator = cells[arg];
+            ++programCounter;
+            break;
+        }
+        case SET:
+        {   // Sets the dataMem[arg] to accumulator, advance 1 instruction
+            memory[arg] = accumulator;
+            ++programCounter;
+            break;
+        }
+        case INSERT:
+        {   // inserts in dataMem[arg] the accumulator value, advance 1 instruction
+            memory.insert(arg, accumulator);
+            ++programCounter;
+            break;
+        }
+        case ERASE:
+        {   // Erases location [arg] from dataMem, advance 1 instruction
+            memory.erase(arg);
+            ++programCounter;
+            break;
+        }
+        case ADDCONST:
+        {   // adds [arg] to accumulator, advance 1 instruction
+            if (!Checked)
+                accumulator += arg;
+            else if (!GVMHelper::checkedAdd(accumulator, arg, accumulator))
+            {
+                raiseFault(programCounter, arg);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case SUBCONST:
+        {   // subtracts [arg] to accumulator, advance 1 instruction
+            if (!Checked)
+                accumulator -= arg;
+            else if (!GVMHelper::checkedSub(accumulator, arg, accumulator))
+            {
+                raiseFault(programCounter, arg);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case MULCONST:
+        {   // multiplies [arg] to accumulator, advance 1 instruction
+            if (!Checked)
+                accumulator *= arg;
+            else if (!GVMHelper::checkedMul(accumulator, arg, accumulator))
+            {
+                raiseFault(programCounter, arg);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case DIVCONST:
+        {   // divides [arg] to accumulator, advance 1 instruction
+            if (!Checked)
+                accumulator /= arg;
+            else if (!GVMHelper::checkedDiv(accumulator, arg, accumulator))
+            {
+                raiseFault(programCounter, arg);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case ADDMEM:
+        {   // adds dataMem[arg] to accumulator, advance 1 instruction
+            long value = cells[arg];
+            if (!Checked)
+                accumulator += value;
+            else if (!GVMHelper::checkedAdd(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case SUBMEM:
+        {   // subtracts dataMem[arg] to accumulator, advance 1 instruction
+            long value = cells[arg];
+            if (!Checked)
+                accumulator -= value;
+            else if (!GVMHelper::checkedSub(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case MULMEM:
+        {   // multiplies dataMem[arg] to accumulator, advance 1 instruction
+            long value = cells[arg];
+            if (!Checked)
+                accumulator *= value;
+            else if (!GVMHelper::checkedMul(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case DIVMEM:
+        {   // divides dataMem[arg] to accumulator, advance 1 instruction
+            long value = cells[arg];
+            if (!Checked)
+                accumulator /= value;
+            else if (!GVMHelper::checkedDiv(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case JUMPREL:
+        {   // advances the instruction set by [arg] (CAN be negative)
+            if (arg == 0)
+                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+            else
+            {
+                jump(arg);
+                break;
+            }
+        }
+        case JUMPZERO:
+        {   // if accumulator == 0, advance instruction set by [arg], otherwise advance by 1
+            if (arg == 0)
+                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+            else
+            {
+                if (accumulator == 0)
+                {
+                    jump(arg);
+                    break;
+                }
+                else
+                {
+                    ++programCounter;
+                    break;
+                }
+            }
+        }
+        case JUMPNZERO:
+        {   // if accumulator != 0, advance instruction set by [arg], otherwise advance by 1
+            if (arg == 0)
+                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+            else
+            {
+                if (accumulator != 0)
+                {
+                    jump(arg);
+                    break;
+                }
+                else
+                {
+                    ++programCounter;
+                    break;
+                }
+            }   
+        }
+        case NOOP:
+        {   // advance 1 instruction
+            ++programCounter;
+            break;
+        }
+        case HALT:
+        {  // Set status to HALTED, advance 1 instruction
+            machineStatus = HALTED;
+            ++programCounter;
+            break;
+        }
+        case OUTPUT:
+        {   // Output accumulator to the output sink, advance 1 instruction
+            emit(accumulator);
+            ++programCounter;
+            break;
+        }
+        case CHECKMEM:
+        {   // checks if DM is of size [arg]. If not, status = ERRORED. Advance 1 instruction
+            long size = static_cast<long>(memory.size());
+            ++programCounter;
+            if (size < arg)
+            {
+                machineStatus = ERRORED;
+                break;
+            }
+            else
+            {
+                break;
+            }
+        }
+        case LOADREG:
+        {   // Sets the accumulator to register [arg], advance 1 instruction
+            accumulator = reg(arg);
+            ++programCounter;
+            break;
+        }
+        case STOREREG:
+        {   // Sets register [arg] to the accumulator, advance 1 instruction
+            reg(arg) = accumulator;
+            ++programCounter;
+            break;
+        }
+        case ADDREG:
+        {   // adds register [arg] to accumulator, advance 1 instruction
+            long value = reg(arg);
+            if (!Checked)
+                accumulator += value;
+            else if (!GVMHelper::checkedAdd(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case SUBREG:
+        {   // subtracts register [arg] from accumulator, advance 1 instruction
+            long value = reg(arg);
+            if (!Checked)
+                accumulator -= value;
+            else if (!GVMHelper::checkedSub(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case MULREG:
+        {   // multiplies accumulator by register [arg], advance 1 instruction
+            long value = reg(arg);
+            if (!Checked)
+                accumulator *= value;
+            else if (!GVMHelper::checkedMul(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        case DIVREG:
+        {   // divides accumulator by register [arg], advance 1 instruction
+            long value = reg(arg);
+            if (!Checked)
+                accumulator /= value;
+            else if (!GVMHelper::checkedDiv(accumulator, value, accumulator))
+            {
+                raiseFault(programCounter, value);
+                break;
+            }
+            ++programCounter;
+            break;
+        }
+        default:
+            throw std::invalid_argument("Instruction not found");
+    }
+}
+
+// runs the program one Instruction at a time through evaluateInstruction() until it ends or [budget]
+// instructions have run. The [Profiled] and [Traced] instantiations report every instruction to the attached
+// profiler and tracer before it runs
+template <bool Profiled, bool Traced, typename Memory>
+void GritContext::runSwitch(Memory& memory, unsigned long long budget)
+{
+    // while not on the last instruction
+    const Instruction* instructions = program->data();
+    const BoundsAnalysis& bounds = program->bounds();
+    long programSize = program->size();
+    for (; programCounter < programSize && budget > 0; --budget)
+    {
+        // execute current instruction if status is RUNNING
+        if (machineStatus == RUNNING)
+        {
+            const Instruction& instruct = instructions[programCounter];
+            if (Profiled)
+                profiler->record(programCounter, accumulator);
+            if (Traced)
+                tracer->record(programCounter, instruct.operation, accumulator);
+            if (boundsChecking && bounds.needsCheck(programCounter))
+            {   // the access could not be proven in bounds, check it
+                if (instruct.argument < 0 || static_cast<long>(memory.size()) < BoundsAnalysis::requiredSize(instruct))
+                    throw std::out_of_range("Data memory access out of bounds");
+            }
+            if (checkedArithmetic)
+                evaluateInstruction<true>(instruct, memory);
+            else
+                evaluateInstruction<false>(instruct, memory);
+        }
+        else
+            break;
+    }
+}
+
+// passes the buffered OUTPUT values to the sink
+void GritContext::drainOutput()
+{
+    static StreamSink standardOutput(std::cout);
+
+    size_t count = outputCount;
+    outputCount = 0;
+    (output ? *output : standardOutput).write(outputBuffer, count);
+    outputUnflushed = true;
+}
+
+// passes the buffered OUTPUT values to the sink and flushes it, if anything was printed since the last flush
+void GritContext::flushOutput()
+{
+    if (outputCount == 0 && !outputUnflushed)
+        return;
+    if (outputCount > 0)
+        drainOutput();
+    outputUnflushed = false;
+    if (output)
+        output->flush();
+    else
+        std::cout.flush();
+}
+
+// replaces the contents of the data memory in use with the [count] values at [values]
+void GritContext::loadMemory(const long* values, size_t count)
+{
+    if (layout == GAP_MEMORY)
+        gapMem.assign(values, count);
+    else if (layout == PAGED_MEMORY)
+        pagedMem.assign(values, count);
+    else
+        dataMem.assign(values, count);
+}
+
+// attaches [prog] and loads [initialMemory] into dataMem, replacing any previous state
+// Sets machineStatus from the program's load status (see header)
+STATUS GritContext::attach(std::shared_ptr<const GritProgram> prog, const std::vector<long> &initialMemory)
+{
+    reset();
+    program = prog;
+
+    // a program that failed to load is ERRORED and never gets data memory
+    machineStatus = program->status();
+    if (machineStatus == ERRORED)
+        return machineStatus;
+
+    // copy the vector passed in to the data memory
+    loadMemory(initialMemory.data(), initialMemory.size());
+
+    return machineStatus;
+}
+
+// attaches [prog] with the data memory held in [filename] (see header), replacing any previous state. Sets
+// machineStatus from the program's load status; a program that failed to load does not open the file
+STATUS GritContext::attachMemoryFile(std::shared_ptr<const GritProgram> prog, const std::string& filename)
+{
+    reset();
+    program = prog;
+    if (layout != PAGED_MEMORY)
+        setMemoryLayout(PAGED_MEMORY);
+
+    machineStatus = program->status();
+    if (machineStatus == ERRORED)
+        return machineStatus;
+
+    pagedMem.mapFile(filename);
+    return machineStatus;
+}
+
+// Prepares the attached program to run again on [initialMemory], without reloading it:
+// replaces dataMem, sets the accumulator, registers and program counter to 0 and the machine status to READY.
+// Returns the current status unchanged if no runnable program is attached
+STATUS GritContext::restart(const std::vector<long> &initialMemory)
+{
+    if (!program || program->status() != READY)
+        return machineStatus;
+
+    loadMemory(initialMemory.data(), initialMemory.size());
+    accumulator = 0;
+    std::fill(registers, registers + GVM_REGISTERS, 0);
+    programCounter = 0;
+    machineStatus = READY;
+    fault = ArithmeticFault();
+
+    return machineStatus;
+}
+
+// Runs the attached program with [engine] until it ends, returns machineStatus when it terminates
+STATUS GritContext::run(ENGINE engine)
+{
+    return runFor(NO_BUDGET, engine);
+}
+
+// Runs a READY program, or resumes a RUNNING one, with [engine] for at most [budget] instructions (see header)
+// Returns HALTED once the program has ended, RUNNING if the budget ran out first, or ERRORED after an arithmetic fault
+STATUS GritContext::runFor(unsigned long long budget, ENGINE engine)
+{
+    // if not READY or stopped by a previous budget, return current status
+    if (machineStatus != READY && machineStatus != RUNNING)
+        return machineStatus;
+
+    bool resuming = (machineStatus == RUNNING);
+    machineStatus = RUNNING;
+    fault = ArithmeticFault();
+    try
+    {
+        if (profiler || tracer)
+            runInstrumented(budget, resuming);
+        else if (engine == JIT_ENGINE && budget == NO_BUDGET && programCounter == 0)
+            runJit();
+        else if (engine == JIT_ENGINE || engine == THREADED_ENGINE)
+            runThreaded(budget);
+        else
+            withMemory([&](auto& memory) { runSwitch<false, false>(memory, budget); });
+    }
+    catch (...)
+    {   // what the program printed before the exception still reaches the sink
+        flushOutput();
+        throw;
+    }
+    flushOutput();
+
+    // a program still RUNNING before its end was stopped by the budget and resumes from programCounter;
+    // one stopped by an arithmetic fault stays ERRORED
+    if ((machineStatus == RUNNING && programCounter < program->size()) || fault.instruction >= 0)
+        return machineStatus;
+
+    machineStatus = HALTED;
+    return machineStatus;
+}
+
+// Runs a READY program, or resumes a RUNNING one, with [engine] until it ends or [deadline] passes. The clock is
+// read between slices of DEADLINE_SLICE instructions, so at least one slice runs and the deadline may be
+// overrun by up to one slice. Returns HALTED once the program has ended, RUNNING if the deadline passed first
+STATUS GritContext::runUntil(std::chrono::steady_clock::time_point deadline, ENGINE engine)
+{
+    STATUS result = runFor(DEADLINE_SLICE, engine);
+    while (result == RUNNING && std::chrono::steady_clock::now() < deadline)
+        result = runFor(DEADLINE_SLICE, engine);
+    return result;
+}
+
+// runs the program through the instrumented switch engine, whichever engine was asked for, so the profile
+// and trace count source instructions. The profiler sees one run from the first slice to the one that ends
+// it, even by an exception, and is only paused between slices; the tracer is told when the run stops
+// ERRORED or with an exception
+void GritContext::runInstrumented(unsigned long long budget, bool resuming)
+{
+    if (profiler && resuming && profiler->running())
+        profiler->resume();
+    else if (profiler)
+        profiler->begin(program->data(), program->size());
+    try
+    {
+        if (profiler && tracer)
+            withMemory([&](auto& memory) { runSwitch<true, true>(memory, budget); });
+        else if (profiler)
+            withMemory([&](auto& memory) { runSwitch<true, false>(memory, budget); });
+        else
+            withMemory([&](auto& memory) { runSwitch<false, true>(memory, budget); });
+    }
+    catch (...)
+    {
+        if (profiler)
+            profiler->end();
+        if (tracer)
+            tracer->stoppedWithError();
+        throw;
+    }
+    if (profiler && machineStatus == RUNNING && programCounter < program->size())
+        profiler->pause();
+    else if (profiler)
+        profiler->end();
+    if (tracer && machineStatus == ERRORED)
+        tracer->stoppedWithError();
+}
+
+// switches the data memory to [newLayout], carrying the current contents over. Leaving PAGED_MEMORY copies every
+// cell, so it throws std::length_error, keeping the layout, when they would not fit in physical memory
+void GritContext::setMemoryLayout(MEMORY_LAYOUT newLayout)
+{
+    if (newLayout == layout)
+        return;
+
+    std::vector<long> contents;
+    copyDataMem(contents);
+    dataMem.clear();
+    gapMem.clear();
+    pagedMem.clear();
+    layout = newLayout;
+    loadMemory(contents.data(), contents.size());
+}
+
+// Detaches the program, sets the accumulator, registers and program counter to 0, clears dataMem and sets the status to WAITING
+void GritContext::reset()
+{
+    program.reset();
+    dataMem.clear();
+    gapMem.clear();
+    pagedMem.clear();
+    accumulator = 0;
+    std::fill(registers, registers + GVM_REGISTERS, 0);
+    programCounter = 0;
+    machineStatus = WAITING;
+    fault = ArithmeticFault();
+    lineage.reset();
+}
+
+// captures the current state (see GritSnapshot.hpp). On PAGED_MEMORY the snapshot takes the pages themselves;
+// the other layouts are copied, sharing the pages unchanged since the last snapshot taken or restored
+std::shared_ptr<const GritSnapshot> GritContext::snapshot()
+{
+    std::shared_ptr<const GritSnapshot> snap;
+    if (layout == PAGED_MEMORY)
+    {
+        std::vector<SharedPage> pages;
+        pagedMem.sharePages(pages);
+        snap = std::make_shared<const GritSnapshot>(program, programCounter, accumulator, registers, machineStatus, std::move(pages), pagedMem.size());
+    }
+    else if (layout == GAP_MEMORY)
+    {
+        std::vector<long> contents;
+        copyDataMem(contents);
+        snap = std::make_shared<const GritSnapshot>(program, programCounter, accumulator, registers, machineStatus, contents.data(), contents.size(), lineage.get());
+    }
+    else
+        snap = std::make_shared<const GritSnapshot>(program, programCounter, accumulator, registers, machineStatus, dataMem.data(), dataMem.size(), lineage.get());
+    lineage = snap;
+    return snap;
+}
+
+// replaces the program, program counter, accumulator, registers, status and data memory with those of [snap], which
+// becomes the snapshot later snapshots share pages with. Returns the restored status. PAGED_MEMORY takes the
+// snapshot's pages without copying them; the other layouts copy them out, and throw std::length_error, leaving
+// this context unchanged, if that would not fit in physical memory
+STATUS GritContext::restore(std::shared_ptr<const GritSnapshot> snap)
+{
+    if (layout != PAGED_MEMORY)
+        PagedMemory::checkDense(snap->size());
+    reset();
+    if (!snap->getProgram())
+        return machineStatus;
+
+    program = snap->getProgram();
+    if (layout == PAGED_MEMORY)
+        pagedMem.adoptPages(snap->memoryPages(), snap->size());
+    else if (layout == GAP_MEMORY)
+    {
+        std::vector<long> contents;
+        snap->copyMemory(contents);
+        gapMem.assign(contents.data(), contents.size());
+    }
+    else
+    {
+        dataMem.resize(snap->size());
+        snap->copyMemory(dataMem.data());
+    }
+    programCounter = snap->getProgramCounter();
+    accumulator = snap->getAccumulator();
+    std::copy(snap->getRegisters(), snap->getRegisters() + GVM_REGISTERS, registers);
+    machineStatus = snap->status();
+    lineage = snap;
+    return machineStatus;
+}
+
+// returns a new context holding this context's state, sharing the snapshot both now descend from. On PAGED_MEMORY
+// the two share every page until one of them writes it; the other layouts copy the memory (see GritSnapshot.hpp)
+std::unique_ptr<GritContext> GritContext::fork()
+{
+    std::unique_ptr<GritContext> child(new GritContext());
+    child->layout = layout;
+    child->boundsChecking = boundsChecking;
+    child->checkedArithmetic = checkedArithmetic;
+    child->restore(snapshot());
+    return child;
+}
+
+// returns a copy of the current dataMem
+std::vector<long> GritContext::getDataMem() const
+{
+    std::vector<long> to_return;
+    copyDataMem(to_return);
+    return to_return;
+}
+
+// copies the current dataMem into [out], reusing its storage instead of returning a new vector. A PAGED_MEMORY too
+// large to hold contiguously in physical memory throws std::length_error instead
+void GritContext::copyDataMem(std::vector<long>& out) const
+{
+    if (layout == GAP_MEMORY)
+    {
+        out.resize(gapMem.size());
+        gapMem.copyTo(out.data());
+    }
+    else if (layout == PAGED_MEMORY)
+    {
+        PagedMemory::checkDense(pagedMem.size());
+        out.resize(pagedMem.size());
+        pagedMem.copyTo(out.data());
+    }
+    else
+        out.assign(dataMem.data(), dataMem.data() + dataMem.size());
+}
+
+// number of cells in data memory
+size_t GritContext::memorySize() const
+{
+    if (layout == GAP_MEMORY)
+        return gapMem.size();
+    return (layout == PAGED_MEMORY) ? pagedMem.size() : dataMem.size();
+}
+
+// grows data memory to [cells] cells, the new ones 0, or cuts it to its first [cells]. On PAGED_MEMORY growing
+// allocates nothing; the other layouts hold every cell
+void GritContext::resizeMemory(size_t cells)
+{
+    if (layout == PAGED_MEMORY)
+    {
+        pagedMem.resize(cells);
+        return;
+    }
+    std::vector<long> contents;
+    copyDataMem(contents);
+    contents.resize(cells, 0);
+    loadMemory(contents.data(), contents.size());
+}
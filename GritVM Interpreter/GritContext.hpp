@@ -0,0 +1,209 @@
+/***********************************************************************
+ * GritContext.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GritContext class, the mutable state of
+ *              one execution of a GritVM program: data memory, accumulator,
+ *              program counter and status. The program itself is a shared
+ *              GritProgram, so any number of contexts (one per thread, or
+ *              one per job) run the same loaded program without copying it.
+ *
+ *              A single GritContext must only be used by one thread at a time.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GRITCONTEXT_H
+#define GRITCONTEXT_H
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+#include "GapBuffer.hpp"
+#include "PagedMemory.hpp"
+#include "GritProgram.hpp"
+#include "GritSnapshot.hpp"
+#include "GVMProfiler.hpp"
+#include "GVMTracer.hpp"
+#include "OutputSink.hpp"
+
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Execution engines a GritContext can run a program with
+typedef enum _engine {
+  SWITCH_ENGINE,    // evaluates one Instruction at a time through evaluateInstruction()
+  THREADED_ENGINE,  // runs the pre-decoded program with computed-goto dispatch where available
+  JIT_ENGINE        // compiles the program to native x86-64 code, falls back to THREADED_ENGINE elsewhere
+} ENGINE;
+
+// Data memory representations a GritContext can hold its data in
+typedef enum _memory_layout {
+  VECTOR_MEMORY,    // contiguous CustomVector: fastest AT/SET, INSERT/ERASE shift every later cell
+  GAP_MEMORY,       // GapBuffer: INSERT/ERASE near the previous edit are O(1); not used by the JIT engine
+  PAGED_MEMORY      // PagedMemory: pages allocated on first access, for sparse use of a huge range; not used by the JIT engine
+} MEMORY_LAYOUT;
+
+// Instruction budget of an unlimited run
+const unsigned long long NO_BUDGET = ULLONG_MAX;
+
+// Number of OUTPUT values a GritContext buffers before handing them to its sink
+const size_t OUTPUT_BUFFER = 128;
+
+// Instructions run between two reads of the clock by GritContext::runUntil()
+const unsigned long long DEADLINE_SLICE = 1 << 16;
+
+// Why a run with checked arithmetic stopped ERRORED. [instruction] is the index of the faulting instruction, -1 if none
+typedef struct _arithmetic_fault {
+  long instruction; std::string message;
+
+  _arithmetic_fault() : instruction(-1) {};
+  std::string toString() const { return std::to_string(instruction) + ": " + message; };
+} ArithmeticFault;
+
+class GritContext
+{
+    private:
+        std::shared_ptr<const GritProgram> program;             // the program being run, nullptr if none
+        MEMORY_LAYOUT layout;                                    // which of dataMem, gapMem and pagedMem holds the data memory
+        bool boundsChecking;                                     // if true, accesses not proven in bounds are checked
+        bool checkedArithmetic;                                  // if true, overflow and division by zero stop the run ERRORED
+        ArithmeticFault fault;                                   // the fault that stopped the last checked run, if any
+        CustomVector<long> dataMem;                              // Vector ADT that holds the data memory for a program (VECTOR_MEMORY)
+        GapBuffer<long> gapMem;                                  // data memory for GAP_MEMORY
+        PagedMemory pagedMem;                                    // data memory for PAGED_MEMORY
+        long programCounter;                                     // Index of the current instruction
+        STATUS machineStatus;                                    // Holds the current status of the program
+        long accumulator;                                        // Works as the accumulator for the GritVM - stores temp values for calculation
+        long registers[GVM_REGISTERS];                           // register file of the *REG instructions
+        GVMProfiler* profiler;                                   // receives every executed instruction if not nullptr, not owned
+        GVMTracer* tracer;                                       // records every executed instruction if not nullptr, not owned
+        OutputSink* output;                                      // receives OUTPUT values, standard output if nullptr; not owned
+        long outputBuffer[OUTPUT_BUFFER];                        // OUTPUT values not yet passed to the sink
+        size_t outputCount;
+        bool outputUnflushed;                                    // values were passed to the sink since it was last flushed
+        std::shared_ptr<const GritSnapshot> lineage;             // snapshot last taken or restored, whose pages the next snapshot shares
+
+        template <bool Checked, typename Memory>
+        void evaluateInstruction(const Instruction& instruct, Memory& memory);  // evaluates [instruct] and alters data members as necessary
+        void jump(long offset);                                  // moves programCounter by [offset], bounds checked against the program
+        long& reg(long index);                                   // register [index], bounds checked against the register file
+        void raiseFault(long instruction, long operand);         // stops the run ERRORED at [instruction], which could not apply [operand]
+        template <bool Profiled, bool Traced, typename Memory>
+        void runSwitch(Memory& memory, unsigned long long budget);  // executes the program through evaluateInstruction() until it ends
+        void runInstrumented(unsigned long long budget, bool resuming);  // runSwitch() reporting to profiler and tracer
+        void runThreaded(unsigned long long budget);             // executes the decoded program until it ends (see GritContextThreaded.cpp)
+        template <bool Sliced, bool Checked, typename Memory>
+        void runDecoded(Memory& memory, long long budget);       // runThreaded() on one memory layout
+        void runJit();                                           // executes the native program (see GritContextJit.cpp)
+        void loadMemory(const long* values, size_t count);       // replaces the data memory in use
+
+        // calls [action] with the data memory in use
+        template <typename Action>
+        void withMemory(Action action)
+        {
+            if (layout == GAP_MEMORY)
+                action(gapMem);
+            else if (layout == PAGED_MEMORY)
+                action(pagedMem);
+            else
+                action(dataMem);
+        };
+
+        // buffers an OUTPUT value
+        void emit(long value)
+        {
+            if (outputCount == OUTPUT_BUFFER)
+                drainOutput();
+            outputBuffer[outputCount++] = value;
+        };
+        void drainOutput();                                      // passes the buffered values to the sink
+        void flushOutput();                                      // drainOutput(), then flushes the sink
+
+        static int jitInsert(JitContext* ctx, long arg);         // JIT helpers for the instructions not generated inline
+        static int jitErase(JitContext* ctx, long arg);
+        static int jitOutput(JitContext* ctx, long arg);
+        static int jitCheckMem(JitContext* ctx, long arg);
+
+        GritContext(const GritContext&);                         // contexts are not copied; share the program instead
+        GritContext& operator=(const GritContext&);
+
+    public:
+        GritContext() : layout(VECTOR_MEMORY), boundsChecking(false), checkedArithmetic(false), programCounter(0), machineStatus(WAITING), accumulator(0), registers(), profiler(nullptr), tracer(nullptr),
+                        output(nullptr), outputCount(0), outputUnflushed(false) {};
+
+        // attaches [prog] with data memory [initialMemory]. The status becomes READY, WAITING if the
+        // program is empty, or ERRORED (with data memory left empty) if the program failed to load
+        STATUS attach(std::shared_ptr<const GritProgram> prog, const std::vector<long>& initialMemory);
+        STATUS restart(const std::vector<long>& initialMemory);  // rewinds the attached program onto new data memory
+
+        // attach() with the data memory held in [filename], switching to PAGED_MEMORY: the memory starts as the file's
+        // contents (native longs; a missing file is created empty) and every change is written to the file, so what
+        // the program leaves there persists. The file stays in use until reset() (which attach() and restore() call)
+        // or setMemoryLayout() to another layout; restart() writes its memory into it. Throws if it cannot be mapped
+        STATUS attachMemoryFile(std::shared_ptr<const GritProgram> prog, const std::string& filename);
+        STATUS run(ENGINE engine = THREADED_ENGINE);             // runs a READY (or resumes a RUNNING) program until it ends
+
+        // time-sliced runs: execute a READY program, or resume a RUNNING one, until it ends or the budget is spent,
+        // then return RUNNING with programCounter, accumulator and data memory preserved so a later run*() call
+        // continues where it stopped. The switch engine counts every instruction. The threaded engine only stops at
+        // backward jumps, charging each loop iteration its length, so a slice may overrun [budget] by the straight-line
+        // code before the next backward jump. The JIT engine runs only unsliced runs from the start, and uses the
+        // threaded engine otherwise
+        STATUS runFor(unsigned long long budget, ENGINE engine = THREADED_ENGINE);
+        STATUS runUntil(std::chrono::steady_clock::time_point deadline, ENGINE engine = THREADED_ENGINE);
+        void reset();                                            // detaches the program and clears all state
+
+        STATUS status() const { return machineStatus; };
+        long getAccumulator() const { return accumulator; };
+        long getRegister(int index) const { return registers[index]; };  // [index] must be below GVM_REGISTERS
+        long getProgramCounter() const { return programCounter; };
+        const std::shared_ptr<const GritProgram>& getProgram() const { return program; };
+        size_t memorySize() const;                               // number of cells in data memory
+        std::vector<long> getDataMem() const;                    // returns a copy of data memory (see PagedMemory::checkDense())
+        void copyDataMem(std::vector<long>& out) const;          // getDataMem() into an existing vector
+
+        // snapshots capture the program, program counter, accumulator, registers, status and data memory (see GritSnapshot.hpp)
+        // between runs. Settings (memory layout, bounds checking, profiler, tracer, output sink) are not part of a snapshot
+        std::shared_ptr<const GritSnapshot> snapshot();
+        STATUS restore(std::shared_ptr<const GritSnapshot> snap); // replaces this context's state with [snap]'s
+        std::unique_ptr<GritContext> fork();                     // a new context in this state, with the same layout and checking
+
+        void setMemoryLayout(MEMORY_LAYOUT newLayout);           // switches representation, keeping the contents
+        void resizeMemory(size_t cells);                         // grows data memory with 0 cells, or cuts it, to [cells]
+        MEMORY_LAYOUT getMemoryLayout() const { return layout; };
+
+        // with bounds checking on, a data memory access that BoundsAnalysis could not prove in bounds is checked
+        // before it runs and throws std::out_of_range if it fails. Proven accesses run unchecked. The JIT
+        // engine falls back to the threaded engine while it is on
+        void setBoundsChecking(bool enabled) { boundsChecking = enabled; };
+        bool getBoundsChecking() const { return boundsChecking; };
+
+        // with checked arithmetic on, an ADD, SUB, MUL or DIV whose result does not fit in a long, or a division
+        // by zero, stops the run ERRORED instead of wrapping or trapping. The accumulator, data memory and
+        // programCounter are left as they were before the faulting instruction, which getFault() describes.
+        // The JIT engine falls back to the threaded engine while it is on
+        void setCheckedArithmetic(bool enabled) { checkedArithmetic = enabled; };
+        bool getCheckedArithmetic() const { return checkedArithmetic; };
+        const ArithmeticFault& getFault() const { return fault; };
+
+        // with a profiler attached every run() executes through an instrumented switch engine, whatever engine
+        // is asked for, and reports each instruction to [prof]. nullptr detaches it. The profiler is not owned
+        // and must outlive its use; the uninstrumented engines are untouched
+        void setProfiler(GVMProfiler* prof) { profiler = prof; };
+        GVMProfiler* getProfiler() const { return profiler; };
+
+        // with a tracer attached every run() likewise executes through the instrumented switch engine and records
+        // each instruction in [trace]'s ring buffer, dumping it if the run stops ERRORED or with an exception (see
+        // GVMTracer.hpp). nullptr detaches it. The tracer is not owned and must outlive its use
+        void setTracer(GVMTracer* trace) { tracer = trace; };
+        GVMTracer* getTracer() const { return tracer; };
+
+        // OUTPUT values are buffered and passed to [sink] in blocks; the sink is flushed when a run stops, even by an
+        // exception. nullptr (the default) writes to std::cout. The sink is not owned and must outlive its use
+        void setOutput(OutputSink* sink) { output = sink; };
+        OutputSink* getOutput() const { return output; };
+};
+
+#endif // GRITCONTEXT_H
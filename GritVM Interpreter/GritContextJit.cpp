@@ -0,0 +1,124 @@
+/***********************************************************************
+ * GritContextJit.cpp
+ * Author: Matthew Sumpter
+ * Description: JIT execution engine for the GritContext class. The shared
+ *              GritProgram is compiled by NativeProgram once, on the
+ *              first JIT run of any context, and executed natively.
+ *              INSERT, ERASE, OUTPUT and CHECKMEM are carried out by the
+ *              helpers below, which use the same data memory operations
+ *              as evaluateInstruction(). Hosts without JIT support, and
+ *              contexts using GAP_MEMORY, PAGED_MEMORY, bounds checking
+ *              or checked arithmetic, fall back to the threaded engine.
+ *
+ *              See GritContext.hpp for class architecture
+ * *********************************************************************/
+
+#include "GritContext.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// compiles the program if no context has yet and runs it natively from the first instruction, translating
+// the native exit code back into machineStatus or the exception the interpreter would throw. programCounter is
+// left where the switch engine leaves it, from the instruction the native code recorded before stopping
+void GritContext::runJit()
+{
+    static const JitHelpers helpers = { &GritContext::jitInsert, &GritContext::jitErase, &GritContext::jitOutput, &GritContext::jitCheckMem };
+    const NativeProgram* nativeMem = (layout == VECTOR_MEMORY && !boundsChecking && !checkedArithmetic) ? program->native(helpers) : nullptr;
+    if (nativeMem == nullptr)
+    {   // unsupported host, no executable memory, a non-contiguous data memory, bounds checking or checked arithmetic, interpret instead
+        runThreaded(NO_BUDGET);
+        return;
+    }
+
+    JitContext ctx;
+    ctx.accumulator = accumulator;
+    ctx.memory = dataMem.data();
+    ctx.owner = this;
+    ctx.instruction = programCounter;
+    std::copy(registers, registers + GVM_REGISTERS, ctx.registers);
+
+    JIT_EXIT exit = nativeMem->run(&ctx);
+    accumulator = ctx.accumulator;
+    std::copy(ctx.registers, ctx.registers + GVM_REGISTERS, registers);
+
+    switch (exit)
+    {
+        case JIT_HALT:
+            machineStatus = HALTED;
+            programCounter = ctx.instruction + 1;
+            break;
+        case JIT_CHECKMEM_FAILED:
+            machineStatus = ERRORED;
+            programCounter = ctx.instruction + 1;
+            break;
+        case JIT_BADJUMP:
+            programCounter = ctx.instruction;
+            throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+        case JIT_BADTARGET:
+            programCounter = ctx.instruction;
+            throw std::out_of_range("Invalid Jump Command. Target is outside of instruction memory");
+        case JIT_UNKNOWN:
+            programCounter = ctx.instruction;
+            throw std::invalid_argument("Instruction not found");
+        case JIT_BADREGISTER:
+            programCounter = ctx.instruction;
+            throw std::out_of_range("Invalid Register. Index is outside of the register file");
+        case JIT_HELPER_THREW:
+            programCounter = ctx.instruction;
+            std::rethrow_exception(ctx.error);
+        default:
+            programCounter = program->size();   // native code does not track the position, only that the program ended
+            break;
+    }
+}
+
+// INSERT helper: inserts the accumulator at dataMem[arg] and refreshes the memory base, since
+// the insert may have reallocated
+int GritContext::jitInsert(JitContext* ctx, long arg)
+{
+    GritContext* vm = static_cast<GritContext*>(ctx->owner);
+    try
+    {
+        vm->dataMem.insert(arg, ctx->accumulator);
+    }
+    catch (...)
+    {   // exceptions must not unwind through generated code
+        ctx->error = std::current_exception();
+        return JIT_HELPER_THREW;
+    }
+    ctx->memory = vm->dataMem.data();
+    return 0;
+}
+
+// ERASE helper: erases dataMem[arg]
+int GritContext::jitErase(JitContext* ctx, long arg)
+{
+    GritContext* vm = static_cast<GritContext*>(ctx->owner);
+    vm->dataMem.erase(vm->dataMem.begin() + arg);
+    ctx->memory = vm->dataMem.data();
+    return 0;
+}
+
+// OUTPUT helper: buffers the accumulator for the output sink
+int GritContext::jitOutput(JitContext* ctx, long)
+{
+    try
+    {
+        static_cast<GritContext*>(ctx->owner)->emit(ctx->accumulator);
+    }
+    catch (...)
+    {
+        ctx->error = std::current_exception();
+        return JIT_HELPER_THREW;
+    }
+    return 0;
+}
+
+// CHECKMEM helper: stops the program if data memory holds fewer than [arg] elements
+int GritContext::jitCheckMem(JitContext* ctx, long arg)
+{
+    GritContext* vm = static_cast<GritContext*>(ctx->owner);
+    long size = static_cast<long>(vm->dataMem.size());
+    return (size < arg) ? JIT_CHECKMEM_FAILED : 0;
+}
@@ -0,0 +1,364 @@
+/***********************************************************************
+ * GritContextThreaded.cpp
+ * Author: Matthew Sumpter
+ * Description: Threaded execution engine for the GritContext class. Runs the
+ *              program pre-decoded (and optionally fused into
+ *              superinstructions) by DecodedProgram at load time. With
+ *              GCC/Clang each handler ends in its own indirect jump through
+ *              a label table (computed goto); other compilers fall back to
+ *              a switch. Produces the same results as evaluateInstruction().
+ *
+ *              See GritContext.hpp for class architecture
+ * *********************************************************************/
+
+#include "GritContext.hpp"
+
+#include <climits>
+#include <stdexcept>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GVM_COMPUTED_GOTO 1
+#endif
+
+// after a jump from entry [from]: in a [Sliced] run, a backward jump charges the loop it closes against
+// the budget and stops the run once the budget is spent. Compiles away in unsliced runs
+#define BACK_EDGE(from)   if (Sliced && ip < (from)) { budget -= ((from) - ip) + 1; if (budget <= 0) goto finished; }
+
+// in a [Checked] run: leaves the handler for the arithmetic fault of the current entry, which could not apply [value]
+#define FAULT(value)      { operand = (value); goto arithmeticFault; }
+
+// runs [statement], which may throw (a PAGED_MEMORY page that cannot be allocated, a backing file that cannot grow,
+// the output sink). If it does, programCounter is left on source instruction [source] of the current entry and the
+// accumulator is written back, as the switch engine leaves them
+#define MAY_THROW(statement, source) \
+    try { statement; } \
+    catch (...) { programCounter = decodedMem.sourceOf(ip - base) + (source); accumulator = acc; throw; }
+
+#ifdef GVM_COMPUTED_GOTO
+    #define HANDLER(op)       handler_##op:
+    #define DISPATCH()        goto *dispatchTable[ip->op]
+    #define DISPATCH_BEGIN()  DISPATCH();
+    #define DISPATCH_END()
+#else
+    #define HANDLER(op)       case op:
+    #define DISPATCH()        goto dispatch
+    #define DISPATCH_BEGIN()  dispatch: switch (ip->op) {
+    #define DISPATCH_END()    default: break; }
+#endif
+
+// executes the program's decoded form on whichever data memory the layout selects, for at most about [budget]
+// instructions (see runDecoded()). A run resumed inside a superinstruction is stepped through the switch
+// engine up to the next handler entry first
+void GritContext::runThreaded(unsigned long long budget)
+{
+    const DecodedProgram& decodedMem = boundsChecking ? program->checkedDecoded() : program->decoded();
+    while (programCounter < program->size() && machineStatus == RUNNING && !decodedMem.startsEntry(programCounter) && budget > 0)
+    {
+        withMemory([&](auto& memory) { runSwitch<false, false>(memory, 1); });
+        if (budget != NO_BUDGET)
+            --budget;
+    }
+    if (programCounter >= program->size() || machineStatus != RUNNING || budget == 0)
+        return;
+
+    bool sliced = (budget != NO_BUDGET);
+    long long fuel = (budget > static_cast<unsigned long long>(LLONG_MAX)) ? LLONG_MAX : static_cast<long long>(budget);
+    withMemory([&](auto& memory) {
+        if (checkedArithmetic)
+            sliced ? runDecoded<true, true>(memory, fuel) : runDecoded<false, true>(memory, fuel);
+        else
+            sliced ? runDecoded<true, false>(memory, fuel) : runDecoded<false, false>(memory, fuel);
+    });
+}
+
+// executes the program's decoded form from programCounter until the program runs off the end, hits HALT or
+// fails a CHECKMEM. The accumulator is kept in a local for the duration of the run and written
+// back, together with programCounter (as a source instruction index), before returning or letting an exception
+// from the data memory or the output sink through (see MAY_THROW). [dataMem] is the data memory to run on. With
+// bounds checking on, the decoded form carrying OP_GUARD entries is run instead
+// A [Sliced] run also stops at the first backward jump that takes [budget] to 0, each loop iteration being
+// charged its length in handler entries; straight-line code is never interrupted
+// A [Checked] run does its arithmetic through the GVMHelper::checked* functions, whose overflow test is the flag
+// the arithmetic instruction itself sets, and stops ERRORED at the first fault (see raiseFault()). The unchecked
+// instantiation's handlers are unchanged
+template <bool Sliced, bool Checked, typename Memory>
+void GritContext::runDecoded(Memory& dataMem, long long budget)
+{
+    const DecodedProgram& decodedMem = boundsChecking ? program->checkedDecoded() : program->decoded();
+    if (decodedMem.empty())
+        return;
+
+#ifdef GVM_COMPUTED_GOTO
+    // must list a label for every DECODED_OP, in enum order
+    static void* const dispatchTable[OP_COUNT] = {
+        &&handler_OP_CLEAR,
+        &&handler_OP_AT, &&handler_OP_SET, &&handler_OP_INSERT, &&handler_OP_ERASE,
+        &&handler_OP_ADDCONST, &&handler_OP_SUBCONST, &&handler_OP_MULCONST, &&handler_OP_DIVCONST,
+        &&handler_OP_ADDMEM, &&handler_OP_SUBMEM, &&handler_OP_MULMEM, &&handler_OP_DIVMEM,
+        &&handler_OP_JUMPREL, &&handler_OP_JUMPZERO, &&handler_OP_JUMPNZERO,
+        &&handler_OP_NOOP, &&handler_OP_HALT, &&handler_OP_OUTPUT, &&handler_OP_CHECKMEM,
+        &&handler_OP_LOADREG, &&handler_OP_STOREREG,
+        &&handler_OP_ADDREG, &&handler_OP_SUBREG, &&handler_OP_MULREG, &&handler_OP_DIVREG,
+        &&handler_OP_UNKNOWN,
+        &&handler_OP_LOADCONST, &&handler_OP_INCMEM, &&handler_OP_INCMEM_JNZ, &&handler_OP_INCMEM_JMP,
+        &&handler_OP_INCREG, &&handler_OP_INCREG_JNZ, &&handler_OP_INCREG_JMP,
+        &&handler_OP_GUARD, &&handler_OP_BADJUMP, &&handler_OP_BADTARGET, &&handler_OP_BADREGISTER, &&handler_OP_END
+    };
+#endif
+
+    const DecodedInstruction* base = decodedMem.entry();
+    const DecodedInstruction* ip = base + decodedMem.entryOf(programCounter);
+    long acc = accumulator;
+    long* regs = registers;     // register indexes were validated by DecodedProgram::decode
+    long operand = 0;           // what a faulting arithmetic entry could not apply
+    const Memory& cells = dataMem;  // reads go through the const [], which leaves a shared PagedMemory page shared
+
+    DISPATCH_BEGIN()
+
+    HANDLER(OP_CLEAR)
+        acc = 0;
+        ++ip; DISPATCH();
+    HANDLER(OP_AT)
+        acc = cells[ip->arg];
+        ++ip; DISPATCH();
+    HANDLER(OP_SET)
+        MAY_THROW(dataMem[ip->arg] = acc, 0);
+        ++ip; DISPATCH();
+    HANDLER(OP_INSERT)
+        MAY_THROW(dataMem.insert(ip->arg, acc), 0);
+        ++ip; DISPATCH();
+    HANDLER(OP_ERASE)
+        MAY_THROW(dataMem.erase(ip->arg), 0);
+        ++ip; DISPATCH();
+    HANDLER(OP_ADDCONST)
+        if (!Checked)
+            acc += ip->arg;
+        else if (!GVMHelper::checkedAdd(acc, ip->arg, acc))
+            FAULT(ip->arg);
+        ++ip; DISPATCH();
+    HANDLER(OP_SUBCONST)
+        if (!Checked)
+            acc -= ip->arg;
+        else if (!GVMHelper::checkedSub(acc, ip->arg, acc))
+            FAULT(ip->arg);
+        ++ip; DISPATCH();
+    HANDLER(OP_MULCONST)
+        if (!Checked)
+            acc *= ip->arg;
+        else if (!GVMHelper::checkedMul(acc, ip->arg, acc))
+            FAULT(ip->arg);
+        ++ip; DISPATCH();
+    HANDLER(OP_DIVCONST)
+        if (!Checked)
+            acc /= ip->arg;
+        else if (!GVMHelper::checkedDiv(acc, ip->arg, acc))
+            FAULT(ip->arg);
+        ++ip; DISPATCH();
+    HANDLER(OP_ADDMEM)
+        if (!Checked)
+            acc += cells[ip->arg];
+        else if (!GVMHelper::checkedAdd(acc, cells[ip->arg], acc))
+            FAULT(cells[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_SUBMEM)
+        if (!Checked)
+            acc -= cells[ip->arg];
+        else if (!GVMHelper::checkedSub(acc, cells[ip->arg], acc))
+            FAULT(cells[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_MULMEM)
+        if (!Checked)
+            acc *= cells[ip->arg];
+        else if (!GVMHelper::checkedMul(acc, cells[ip->arg], acc))
+            FAULT(cells[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_DIVMEM)
+        if (!Checked)
+            acc /= cells[ip->arg];
+        else if (!GVMHelper::checkedDiv(acc, cells[ip->arg], acc))
+            FAULT(cells[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_JUMPREL)
+    {
+        const DecodedInstruction* from = ip;
+        ip += ip->offset;           // target validated by DecodedProgram::decode
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_JUMPZERO)
+    {
+        const DecodedInstruction* from = ip;
+        ip += (acc == 0) ? ip->offset : 1;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_JUMPNZERO)
+    {
+        const DecodedInstruction* from = ip;
+        ip += (acc != 0) ? ip->offset : 1;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_NOOP)
+        ++ip; DISPATCH();
+    HANDLER(OP_HALT)
+        ++ip;
+        machineStatus = HALTED;
+        goto finished;
+    HANDLER(OP_OUTPUT)
+        MAY_THROW(emit(acc), 0);
+        ++ip; DISPATCH();
+    HANDLER(OP_CHECKMEM)
+        ++ip;
+        if (static_cast<long>(dataMem.size()) < (ip - 1)->arg)
+        {
+            machineStatus = ERRORED;
+            goto finished;
+        }
+        DISPATCH();
+    HANDLER(OP_LOADREG)
+        acc = regs[ip->arg];
+        ++ip; DISPATCH();
+    HANDLER(OP_STOREREG)
+        regs[ip->arg] = acc;
+        ++ip; DISPATCH();
+    HANDLER(OP_ADDREG)
+        if (!Checked)
+            acc += regs[ip->arg];
+        else if (!GVMHelper::checkedAdd(acc, regs[ip->arg], acc))
+            FAULT(regs[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_SUBREG)
+        if (!Checked)
+            acc -= regs[ip->arg];
+        else if (!GVMHelper::checkedSub(acc, regs[ip->arg], acc))
+            FAULT(regs[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_MULREG)
+        if (!Checked)
+            acc *= regs[ip->arg];
+        else if (!GVMHelper::checkedMul(acc, regs[ip->arg], acc))
+            FAULT(regs[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_DIVREG)
+        if (!Checked)
+            acc /= regs[ip->arg];
+        else if (!GVMHelper::checkedDiv(acc, regs[ip->arg], acc))
+            FAULT(regs[ip->arg]);
+        ++ip; DISPATCH();
+    HANDLER(OP_LOADCONST)
+        acc = ip->arg;
+        ++ip; DISPATCH();
+    HANDLER(OP_INCMEM)
+        if (!Checked)
+            acc = cells[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(cells[ip->arg], ip->arg2, acc))
+            goto incrementFault;
+        MAY_THROW(dataMem[ip->arg] = acc, 2);      // the SET of the fused sequence
+        ++ip; DISPATCH();
+    HANDLER(OP_INCMEM_JNZ)
+    {
+        const DecodedInstruction* from = ip;
+        if (!Checked)
+            acc = cells[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(cells[ip->arg], ip->arg2, acc))
+            goto incrementFault;
+        MAY_THROW(dataMem[ip->arg] = acc, 2);      // the SET of the fused sequence
+        ip += (acc != 0) ? ip->offset : 1;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_INCMEM_JMP)
+    {
+        const DecodedInstruction* from = ip;
+        if (!Checked)
+            acc = cells[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(cells[ip->arg], ip->arg2, acc))
+            goto incrementFault;
+        MAY_THROW(dataMem[ip->arg] = acc, 2);      // the SET of the fused sequence
+        ip += ip->offset;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_INCREG)
+        if (!Checked)
+            acc = regs[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(regs[ip->arg], ip->arg2, acc))
+            goto registerIncrementFault;
+        regs[ip->arg] = acc;
+        ++ip; DISPATCH();
+    HANDLER(OP_INCREG_JNZ)
+    {
+        const DecodedInstruction* from = ip;
+        if (!Checked)
+            acc = regs[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(regs[ip->arg], ip->arg2, acc))
+            goto registerIncrementFault;
+        regs[ip->arg] = acc;
+        ip += (acc != 0) ? ip->offset : 1;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_INCREG_JMP)
+    {
+        const DecodedInstruction* from = ip;
+        if (!Checked)
+            acc = regs[ip->arg] + ip->arg2;
+        else if (!GVMHelper::checkedAdd(regs[ip->arg], ip->arg2, acc))
+            goto registerIncrementFault;
+        regs[ip->arg] = acc;
+        ip += ip->offset;
+        BACK_EDGE(from);
+        DISPATCH();
+    }
+    HANDLER(OP_UNKNOWN)
+        programCounter = decodedMem.sourceOf(ip - base);
+        accumulator = acc;
+        throw std::invalid_argument("Instruction not found");
+    HANDLER(OP_GUARD)
+        if (ip->arg < 0 || static_cast<long>(dataMem.size()) < ip->arg2)
+        {
+            programCounter = decodedMem.sourceOf(ip - base);
+            accumulator = acc;
+            throw std::out_of_range("Data memory access out of bounds");
+        }
+        ++ip; DISPATCH();
+    HANDLER(OP_BADJUMP)
+        programCounter = decodedMem.sourceOf(ip - base);
+        accumulator = acc;
+        throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+    HANDLER(OP_BADTARGET)
+        programCounter = decodedMem.sourceOf(ip - base);
+        accumulator = acc;
+        throw std::out_of_range("Invalid Jump Command. Target is outside of instruction memory");
+    HANDLER(OP_BADREGISTER)
+        programCounter = decodedMem.sourceOf(ip - base);
+        accumulator = acc;
+        throw std::out_of_range("Invalid Register. Index is outside of the register file");
+    HANDLER(OP_END)
+        goto finished;
+
+    DISPATCH_END()
+
+arithmeticFault:
+    programCounter = decodedMem.sourceOf(ip - base);
+    accumulator = acc;
+    raiseFault(programCounter, operand);
+    return;
+incrementFault:
+    // the ADDCONST/SUBCONST of a fused AT; ADDCONST; SET faulted, after the AT loaded the accumulator
+    programCounter = decodedMem.sourceOf(ip - base) + 1;
+    accumulator = cells[ip->arg];
+    raiseFault(programCounter, ip->arg2);
+    return;
+registerIncrementFault:
+    // the same for a fused LOADREG; ADDCONST; STOREREG
+    programCounter = decodedMem.sourceOf(ip - base) + 1;
+    accumulator = regs[ip->arg];
+    raiseFault(programCounter, ip->arg2);
+    return;
+
+finished:
+    programCounter = decodedMem.sourceOf(ip - base);
+    accumulator = acc;
+}
@@ -0,0 +1,99 @@
+/***********************************************************************
+ * GritProgram.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GritProgram class, a loaded,
+ *              immutable and shareable GritVM program.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GritProgram.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+// makes the [size] instructions at [program] this program's instructions and decodes them
+void GritProgram::finish(const Instruction* program, int size, bool fuse)
+{
+    instructions = program;
+    count = size;
+
+    // validate and pre-decode the program for the threaded engine, fusing superinstructions if enabled
+    decodedMem.decode(instructions, count, fuse);
+
+    // prove what accesses it can in bounds; bounds-checked runs only guard the rest
+    boundsMem.analyze(instructions, count);
+    checkedMem.decode(instructions, count, fuse, &boundsMem);
+
+    // if the program size is 0, status = WAITING. Else, status = READY
+    loadStatus = (count == 0) ? WAITING : READY;
+}
+
+// loads the program in [filename], see header
+std::shared_ptr<const GritProgram> GritProgram::fromFile(const std::string filename, bool fuse)
+{
+    // compiled programs are mapped rather than parsed
+    if (BytecodeImage::isBytecodeFile(filename))
+        return fromBytecode(filename, fuse);
+
+    std::shared_ptr<GritProgram> program(new GritProgram());
+
+    // open [filename] file
+    std::ifstream file(filename, std::ios::binary);
+
+    // if file failed to open, throw error
+    if (!file)
+        throw std::runtime_error(filename + " could not be opened");
+
+    // read the whole .gvm file in one go and parse it in place
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    // if any line is malformed the program is ERRORED (see getLoadError())
+    if (!GVMParser::parse(source, program->instructMem, program->loadError))
+    {
+        program->instructMem.clear();
+        program->loadStatus = ERRORED;
+        return program;
+    }
+
+    program->finish(program->instructMem.data(), program->instructMem.size(), fuse);
+    return program;
+}
+
+// maps the compiled .gvmb program in [filename] (see BytecodeImage.hpp); its instructions are executed
+// in place, without any parsing. Throws if the file cannot be opened; an invalid file gives an ERRORED program
+std::shared_ptr<const GritProgram> GritProgram::fromBytecode(const std::string filename, bool fuse)
+{
+    std::shared_ptr<GritProgram> program(new GritProgram());
+
+    if (!program->imageMem.open(filename))
+        program->loadStatus = ERRORED;
+    else
+        program->finish(program->imageMem.data(), program->imageMem.size(), fuse);
+    return program;
+}
+
+// builds a program from the instructions in [program], see header
+std::shared_ptr<const GritProgram> GritProgram::fromInstructions(const std::vector<Instruction>& program, bool fuse)
+{
+    std::shared_ptr<GritProgram> built(new GritProgram());
+
+    built->instructMem.reserve(program.size());
+    for (const Instruction& instruct : program)
+        built->instructMem.push_back(instruct);
+
+    built->finish(built->instructMem.data(), built->instructMem.size(), fuse);
+    return built;
+}
+
+// returns the program compiled to native code with [helpers], compiling it on the first call
+// Every caller must pass the same helpers, since only the first call compiles
+const NativeProgram* GritProgram::native(const JitHelpers& helpers) const
+{
+    std::call_once(nativeOnce, [&]() {
+        nativeReady = nativeMem.compile(instructions, count, helpers);
+    });
+    return nativeReady ? &nativeMem : nullptr;
+}
@@ -0,0 +1,79 @@
+/***********************************************************************
+ * GritProgram.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GritProgram class, a loaded GritVM
+ *              program: its instructions (parsed from text or mapped from
+ *              .gvmb bytecode), the pre-decoded form used by the threaded
+ *              engine and, on demand, the native code of the JIT engine.
+ *
+ *              A GritProgram never changes after it is created, so a single
+ *              instance is shared through std::shared_ptr<const GritProgram>
+ *              by any number of GritContexts, on any number of threads,
+ *              without locking. The one lazily built part, the native code,
+ *              is compiled exactly once under std::call_once.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GRITPROGRAM_H
+#define GRITPROGRAM_H
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+#include "BoundsAnalysis.hpp"
+#include "DecodedProgram.hpp"
+#include "NativeProgram.hpp"
+#include "BytecodeImage.hpp"
+#include "GVMParser.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class GritProgram
+{
+    private:
+        CustomVector<Instruction> instructMem;          // instructions of a text program
+        BytecodeImage imageMem;                         // mapped instructions of a .gvmb program
+        const Instruction* instructions;                // the program: points into instructMem or imageMem
+        int count;                                      // number of instructions
+        STATUS loadStatus;                              // READY, WAITING if empty or ERRORED if loading failed
+        ParseError loadError;                           // why a text program failed to parse
+        DecodedProgram decodedMem;                      // instructions validated and pre-decoded for the threaded engine
+        BoundsAnalysis boundsMem;                       // which data memory accesses are proven in bounds
+        DecodedProgram checkedMem;                      // decodedMem with guards before the unproven accesses
+
+        mutable std::once_flag nativeOnce;              // guards the one-time JIT compile
+        mutable NativeProgram nativeMem;                // instructions compiled by the JIT engine
+        mutable bool nativeReady;                       // true if nativeMem compiled successfully
+
+        GritProgram() : instructions(nullptr), count(0), loadStatus(WAITING), nativeReady(false) {};
+        void finish(const Instruction* program, int size, bool fuse);
+
+    public:
+        // loads the program in [filename] (.gvm text, or .gvmb bytecode which is memory-mapped). Throws if
+        // the file cannot be opened; a malformed file gives a program whose status() is ERRORED.
+        // If [fuse] is true the threaded engine's decoded form uses superinstructions
+        static std::shared_ptr<const GritProgram> fromFile(const std::string filename, bool fuse = true);
+
+        // loads [filename] as .gvmb bytecode whatever its extension
+        static std::shared_ptr<const GritProgram> fromBytecode(const std::string filename, bool fuse = true);
+
+        // builds a program from [program] directly, e.g. the output of an optimizer pass
+        static std::shared_ptr<const GritProgram> fromInstructions(const std::vector<Instruction>& program, bool fuse = true);
+
+        STATUS status() const { return loadStatus; };
+        const ParseError& getLoadError() const { return loadError; };
+        const Instruction* data() const { return instructions; };
+        int size() const { return count; };
+        const DecodedProgram& decoded() const { return decodedMem; };
+        const BoundsAnalysis& bounds() const { return boundsMem; };
+        const DecodedProgram& checkedDecoded() const { return checkedMem; };    // decoded() for bounds-checked runs
+
+        // the program compiled to native code, compiling it on first call. Returns nullptr if this
+        // host has no JIT support. Thread-safe
+        const NativeProgram* native(const JitHelpers& helpers) const;
+};
+
+#endif // GRITPROGRAM_H
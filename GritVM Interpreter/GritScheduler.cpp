@@ -0,0 +1,197 @@
+/***********************************************************************
+ * GritScheduler.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GritScheduler class, which
+ *              time-slices GritVM jobs over a pool of worker threads with
+ *              work stealing.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GritScheduler.hpp"
+
+#include <algorithm>
+
+// starts the worker threads, see header
+GritScheduler::GritScheduler(unsigned threads, ENGINE engine, unsigned long long slice)
+    : engine(engine), slice(std::max(1ull, slice)), nextQueue(0), queued(0), sleeping(0), stopping(false), outstanding(0)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned t = 0; t < threads; ++t)
+        queues.push_back(std::unique_ptr<RunQueue>(new RunQueue()));
+    for (unsigned t = 0; t < threads; ++t)
+        workers.push_back(std::thread(&GritScheduler::workerLoop, this, t));
+}
+
+// lets every submitted job finish, then stops and joins the workers
+GritScheduler::~GritScheduler()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// appends [job] to run queue [queue] and, if [wakeSleeper], wakes a sleeping worker if there is one. A worker
+// requeuing its own job passes false: it takes a job again straight away, so nothing is left for a sleeper
+void GritScheduler::enqueue(Job* job, size_t queue, bool wakeSleeper)
+{
+    {
+        std::lock_guard<std::mutex> guard(queues[queue]->lock);
+        queues[queue]->jobs.push_back(job);
+    }
+    queued.fetch_add(1);
+
+    // a worker counts itself in [sleeping] before it checks [queued], and both are sequentially consistent, so
+    // either it sees this job or this sees it. Taking sleepLock then orders the increment before its check,
+    // so the wake-up is not lost
+    if (!wakeSleeper || sleeping.load() == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wake.notify_one();
+}
+
+// returns the next job for worker [self]: the front of its own queue, otherwise the back of the first other
+// queue with work in it. Returns nullptr if every queue is empty
+GritScheduler::Job* GritScheduler::take(size_t self)
+{
+    for (size_t n = 0; n < queues.size(); ++n)
+    {
+        RunQueue& queue = *queues[(self + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty())
+            continue;
+
+        Job* job;
+        if (n == 0)
+        {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        else
+        {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        queued.fetch_sub(1);
+        return job;
+    }
+    return nullptr;
+}
+
+// body of worker thread [self]: runs a slice of the next job, requeues it if it has not ended, and
+// sleeps while there is no work anywhere
+void GritScheduler::workerLoop(size_t self)
+{
+    for (;;)
+    {
+        Job* job = take(self);
+        if (job == nullptr)
+        {
+            std::unique_lock<std::mutex> guard(sleepLock);
+            sleeping.fetch_add(1);
+            wake.wait(guard, [this]() { return stopping || queued.load() > 0; });
+            sleeping.fetch_sub(1);
+            if (stopping && queued.load() == 0)
+                return;
+            continue;
+        }
+
+        STATUS status;
+        try
+        {
+            status = job->context->runFor(slice, engine);
+        }
+        catch (...)
+        {
+            finish(job, std::current_exception());
+            continue;
+        }
+
+        if (status == RUNNING)
+            enqueue(job, self, false);
+        else
+            finish(job, nullptr);
+    }
+}
+
+// reports the result of [job], which ended or threw [error], and releases it
+void GritScheduler::finish(Job* job, std::exception_ptr error)
+{
+    JobResult result;
+    result.status = error ? ERRORED : job->context->status();
+    result.accumulator = job->context->getAccumulator();
+    job->context->copyDataMem(result.dataMem);     // jobs run on VECTOR_MEMORY: no larger than the memory they held
+    result.error = error;
+
+    if (job->callback)
+    {
+        try
+        {
+            job->callback(result);
+        }
+        catch (...)
+        {   // a throwing callback must not take the worker down; the job still counts as finished
+        }
+    }
+    else if (error)
+        job->promise.set_exception(error);
+    else
+        job->promise.set_value(std::move(result));
+    delete job;
+
+    std::lock_guard<std::mutex> guard(doneLock);
+    if (--outstanding == 0)
+        allDone.notify_all();
+}
+
+// attaches a context for [job] and hands it to the next run queue in turn
+void GritScheduler::submitJob(Job* job, std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory)
+{
+    job->context.reset(new GritContext());
+    job->context->attach(program, initialMemory);
+    {
+        std::lock_guard<std::mutex> guard(doneLock);
+        ++outstanding;
+    }
+    enqueue(job, nextQueue.fetch_add(1) % queues.size(), true);
+}
+
+// queues a job whose result is delivered through the returned future, see header
+std::future<JobResult> GritScheduler::submit(std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory)
+{
+    Job* job = new Job();
+    std::future<JobResult> result = job->promise.get_future();
+    submitJob(job, program, initialMemory);
+    return result;
+}
+
+// queues a job whose result is passed to [callback], see header
+void GritScheduler::submit(std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory, JobCallback callback)
+{
+    Job* job = new Job();
+    job->callback = callback;
+    submitJob(job, program, initialMemory);
+}
+
+// blocks until every submitted job has finished
+void GritScheduler::wait()
+{
+    std::unique_lock<std::mutex> guard(doneLock);
+    allDone.wait(guard, [this]() { return outstanding == 0; });
+}
+
+// returns the number of submitted jobs that have not finished
+size_t GritScheduler::pending()
+{
+    std::lock_guard<std::mutex> guard(doneLock);
+    return outstanding;
+}
@@ -0,0 +1,111 @@
+/***********************************************************************
+ * GritScheduler.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GritScheduler class, which runs many
+ *              GritVM jobs on a fixed pool of worker threads.
+ *
+ *              Every job is a GritContext running a shared GritProgram on
+ *              its own data memory. Workers run a job for one slice of
+ *              instructions (GritContext::runFor) and then put it back at
+ *              the end of their run queue, so long-running or runaway
+ *              programs cannot starve the others. Each worker has its own
+ *              queue; a worker whose queue is empty steals from the far end
+ *              of another's, and sleeps only when every queue is empty.
+ *              Requeuing a slice touches only the worker's own queue: the
+ *              shared sleep lock is taken, and a sleeper woken, only when a
+ *              new job arrives while some worker is asleep.
+ *
+ *              Completion is reported through a std::future or a callback.
+ *              Callbacks run on the worker thread that finished the job and
+ *              may submit further jobs.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GRITSCHEDULER_H
+#define GRITSCHEDULER_H
+
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default number of instructions a job runs before it yields its worker
+const unsigned long long SCHEDULER_SLICE = 1 << 14;
+
+// The outcome of a job. [error] holds the exception the program threw, if any, in which
+// case [status] is ERRORED and [dataMem] is the memory at the point it threw
+typedef struct _job_result {
+  STATUS status; long accumulator;
+  std::vector<long> dataMem;
+  std::exception_ptr error;
+
+  _job_result() : status(WAITING), accumulator(0) {};
+} JobResult;
+
+typedef std::function<void(JobResult&)> JobCallback;
+
+class GritScheduler
+{
+    private:
+        typedef struct _job {
+          std::unique_ptr<GritContext> context;
+          std::promise<JobResult> promise;                      // fulfilled if [callback] is empty
+          JobCallback callback;
+        } Job;
+
+        typedef struct _run_queue {
+          std::mutex lock;
+          std::deque<Job*> jobs;                                // the owner takes from the front, thieves from the back
+        } RunQueue;
+
+        ENGINE engine;                                          // engine every job runs with
+        unsigned long long slice;                               // instructions per turn
+        std::vector<std::unique_ptr<RunQueue> > queues;         // one per worker
+        std::vector<std::thread> workers;
+
+        std::atomic<size_t> nextQueue;                          // round-robin position for submissions
+        std::atomic<size_t> queued;                             // jobs waiting in any queue
+        std::atomic<size_t> sleeping;                           // workers asleep, or about to check [queued] and sleep
+        std::mutex sleepLock;                                   // guards sleeping workers against lost wake-ups
+        std::condition_variable wake;
+        bool stopping;                                          // set (under sleepLock) by the destructor
+
+        std::mutex doneLock;
+        std::condition_variable allDone;
+        size_t outstanding;                                     // submitted jobs not yet finished, guarded by doneLock
+
+        void enqueue(Job* job, size_t queue, bool wakeSleeper);
+        Job* take(size_t self);                                 // from the worker's own queue, else stolen from another
+        void workerLoop(size_t self);
+        void finish(Job* job, std::exception_ptr error);
+        void submitJob(Job* job, std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory);
+
+        GritScheduler(const GritScheduler&);                    // the scheduler owns its threads, it is not copied
+        GritScheduler& operator=(const GritScheduler&);
+
+    public:
+        // starts [threads] workers (0 = one per hardware thread) running jobs with [engine], [slice] instructions at a time
+        GritScheduler(unsigned threads = 0, ENGINE engine = THREADED_ENGINE, unsigned long long slice = SCHEDULER_SLICE);
+        ~GritScheduler();                                       // finishes every submitted job, then stops the workers
+
+        // queues [program] to run on a copy of [initialMemory]. The future receives the result, or the exception the run threw
+        std::future<JobResult> submit(std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory);
+        // as submit(), but [callback] receives the result on the worker thread that finished the job
+        void submit(std::shared_ptr<const GritProgram> program, const std::vector<long>& initialMemory, JobCallback callback);
+
+        void wait();                                            // blocks until no submitted job is left unfinished
+        size_t pending();                                       // jobs submitted and not yet finished
+        unsigned threadCount() const { return static_cast<unsigned>(workers.size()); };
+};
+
+#endif // GRITSCHEDULER_H
@@ -0,0 +1,103 @@
+/***********************************************************************
+ * GritSnapshot.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the GritSnapshot class, which
+ *              captures GritContext state in shared data pages.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "GritSnapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// true if the [cells] cells at [first] are all 0
+static bool allZero(const long* first, size_t cells)
+{
+    for (size_t i = 0; i < cells; ++i)
+    {
+        if (first[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+// captures the state from contiguous memory, sharing unchanged pages with [base], see header
+GritSnapshot::GritSnapshot(std::shared_ptr<const GritProgram> program, long programCounter, long accumulator, const long* registers,
+                           STATUS status, const long* memory, size_t count, const GritSnapshot* base)
+    : program(program), programCounter(programCounter), accumulator(accumulator), machineStatus(status), memorySize(count)
+{
+    std::copy(registers, registers + GVM_REGISTERS, this->registers);
+
+    pages.resize((count + MEMORY_PAGE - 1) / MEMORY_PAGE);
+    for (size_t start = 0; start < count; start += MEMORY_PAGE)
+    {
+        size_t length = std::min(MEMORY_PAGE, count - start);
+        size_t index = start / MEMORY_PAGE;
+        if (allZero(memory + start, length))
+            continue;
+
+        // the same cells as base's page: share it rather than store another copy. Cells past the end of
+        // memory are 0 in every page
+        if (base && index < base->pages.size() && base->pages[index]
+            && std::memcmp(base->pages[index].get(), memory + start, length * sizeof(long)) == 0
+            && allZero(base->pages[index].get() + length, MEMORY_PAGE - length))
+        {
+            pages[index] = base->pages[index];
+            continue;
+        }
+        pages[index] = SharedPage(new long[MEMORY_PAGE](), std::default_delete<long[]>());
+        std::memcpy(pages[index].get(), memory + start, length * sizeof(long));
+    }
+}
+
+// captures the state with the pages of a PagedMemory, see header
+GritSnapshot::GritSnapshot(std::shared_ptr<const GritProgram> program, long programCounter, long accumulator, const long* registers,
+                           STATUS status, std::vector<SharedPage> pages, size_t count)
+    : program(program), programCounter(programCounter), accumulator(accumulator), machineStatus(status), memorySize(count),
+      pages(std::move(pages))
+{
+    std::copy(registers, registers + GVM_REGISTERS, this->registers);
+}
+
+// copies the data memory into [out], replacing its contents. Throws std::length_error rather than allocate more
+// than the host's physical memory
+void GritSnapshot::copyMemory(std::vector<long>& out) const
+{
+    PagedMemory::checkDense(memorySize);
+    out.resize(memorySize);
+    copyMemory(out.data());
+}
+
+// copies the data memory, in order, to [out]
+void GritSnapshot::copyMemory(long* out) const
+{
+    for (size_t start = 0; start < memorySize; start += MEMORY_PAGE)
+    {
+        size_t length = std::min(MEMORY_PAGE, memorySize - start);
+        const SharedPage& page = pages[start / MEMORY_PAGE];
+        if (page)
+            std::memcpy(out + start, page.get(), length * sizeof(long));
+        else
+            std::fill(out + start, out + start + length, 0);
+    }
+}
+
+// returns the number of pages stored, leaving out the pages of zeros
+size_t GritSnapshot::residentPages() const
+{
+    return static_cast<size_t>(std::count_if(pages.begin(), pages.end(), [](const SharedPage& page) { return page != nullptr; }));
+}
+
+// returns the number of page positions at which this snapshot and [other] share storage
+size_t GritSnapshot::sharedPages(const GritSnapshot& other) const
+{
+    size_t shared = 0;
+    for (size_t p = 0; p < std::min(pages.size(), other.pages.size()); ++p)
+    {
+        if (pages[p] && pages[p] == other.pages[p])
+            ++shared;
+    }
+    return shared;
+}
@@ -0,0 +1,75 @@
+/***********************************************************************
+ * GritSnapshot.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the GritSnapshot class, an immutable copy
+ *              of the execution state of a GritContext: program, program
+ *              counter, accumulator, registers, status and data memory.
+ *
+ *              Data memory is stored in pages of MEMORY_PAGE cells, the
+ *              pages of PagedMemory, with no page at all for one that is
+ *              all zeros. On PAGED_MEMORY a snapshot takes the context's
+ *              pages and a restore hands them to the context, copying no
+ *              cell: both are O(pages), and the context clones a page the
+ *              first time it writes it while a snapshot still holds it.
+ *              A fork() there is a snapshot and a restore, so it costs
+ *              O(pages) and then one page copy per page either side
+ *              writes. VECTOR_MEMORY and GAP_MEMORY keep their cells
+ *              contiguous, so a snapshot copies the memory once (sharing
+ *              every page equal to the same page of the snapshot the
+ *              context last took or was restored from) and a restore or
+ *              fork copies it once more: O(memory).
+ *
+ *              Snapshots are shared through std::shared_ptr<const
+ *              GritSnapshot> and may be restored into any number of
+ *              contexts, on any thread.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef GRITSNAPSHOT_H
+#define GRITSNAPSHOT_H
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "PagedMemory.hpp"
+
+#include <memory>
+#include <vector>
+
+class GritSnapshot
+{
+    private:
+        std::shared_ptr<const GritProgram> program;
+        long programCounter;
+        long accumulator;
+        long registers[GVM_REGISTERS];
+        STATUS machineStatus;
+        size_t memorySize;                                      // number of data memory cells
+        std::vector<SharedPage> pages;                          // data memory, MEMORY_PAGE cells each, nullptr for a page of zeros
+
+    public:
+        // captures the given state, with the GVM_REGISTERS registers at [registers] and the [count] data memory
+        // cells at [memory]. Pages equal to the same page of [base] are shared with it
+        GritSnapshot(std::shared_ptr<const GritProgram> program, long programCounter, long accumulator, const long* registers,
+                     STATUS status, const long* memory, size_t count, const GritSnapshot* base);
+        // captures the given state with the [count] data memory cells held in [pages] (see PagedMemory::sharePages())
+        GritSnapshot(std::shared_ptr<const GritProgram> program, long programCounter, long accumulator, const long* registers,
+                     STATUS status, std::vector<SharedPage> pages, size_t count);
+
+        const std::shared_ptr<const GritProgram>& getProgram() const { return program; };
+        long getProgramCounter() const { return programCounter; };
+        long getAccumulator() const { return accumulator; };
+        const long* getRegisters() const { return registers; };  // GVM_REGISTERS values
+        STATUS status() const { return machineStatus; };
+        size_t size() const { return memorySize; };             // number of data memory cells
+        void copyMemory(std::vector<long>& out) const;          // the data memory, into [out]; throws as PagedMemory::checkDense()
+        void copyMemory(long* out) const;                       // the data memory, to [out], which must have room for size()
+
+        // the data memory's pages, for PagedMemory::adoptPages(). Read only: a page is never written while shared
+        const std::vector<SharedPage>& memoryPages() const { return pages; };
+        size_t pageCount() const { return pages.size(); };
+        size_t residentPages() const;                           // pages stored, i.e. not all zeros
+        size_t sharedPages(const GritSnapshot& other) const;    // pages stored once for both snapshots
+};
+
+#endif // GRITSNAPSHOT_H
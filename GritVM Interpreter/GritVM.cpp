@@ -5,6 +5,9 @@
  *              the GritVM programming language. It can read in a file of code
  *              written in GritVM, run the instructions, and hold the results
  *              in object memory.
+ *
+ *              The program is loaded into a GritProgram and executed by a
+ *              GritContext (see GritProgram.hpp and GritContext.hpp).
  * 
  *              See header file for class architecture
  * *********************************************************************/
@@ -12,279 +15,131 @@
 #include "GritVM.hpp"
 #include "CustomVector.hpp"
 
-#include <fstream>
-#include <stdexcept>
 #include <iostream>
 #include <string>
 #include <vector>
 
-// takes Instruction object [instruct] as parameter, evaluates it and alters data members as necessary
-void GritVM::evaluateInstruction(const Instruction& instruct)
-{
-    long arg = instruct.argument;  // capture argument variable
-
-    // each case carries out a potential instruction operation
-    switch (instruct.operation)
-    {
-        case CLEAR:
-        {   // set accumulator to 0, advance 1 instruction
-            accumulator = 0;
-            ++currentInstruct;
-            break;
-        }
-        case AT:
-        {   // Sets the accumulator to the value at dataMem[arg], advance 1 instruction
-            accumulator = dataMem[arg];
-            ++currentInstruct;
-            break;
-        }
-        case SET:
-        {   // Sets the dataMem[arg] to accumulator, advance 1 instruction
-            dataMem[arg] = accumulator;
-            ++currentInstruct;
-            break;
-        }
-        case INSERT:
-        {   // inserts in dataMem[arg] the accumulator value, advance 1 instruction
-            dataMem.insert(arg, accumulator);
-            ++currentInstruct;
-            break;
-        }
-        case ERASE:
-        {   // Erases location [arg] from dataMem, advance 1 instruction
-            CustomVector<long>::Iterator it = dataMem.begin() + arg;
-            dataMem.erase(it);
-            ++currentInstruct;
-            break;
-        }
-        case ADDCONST:
-        {   // adds [arg] to accumulator, advance 1 instruction
-            accumulator += arg;
-            ++currentInstruct;
-            break;
-        }
-        case SUBCONST:
-        {   // subtracts [arg] to accumulator, advance 1 instruction
-            accumulator -= arg;
-            ++currentInstruct;
-            break;
-        }
-        case MULCONST:
-        {   // multiplies [arg] to accumulator, advance 1 instruction
-            accumulator *= arg;
-            ++currentInstruct;
-            break;
-        }
-        case DIVCONST:
-        {   // divides [arg] to accumulator, advance 1 instruction
-            accumulator /= arg;
-            ++currentInstruct;
-            break;
-        }
-        case ADDMEM:
-        {   // adds dataMem[arg] to accumulator, advance 1 instruction
-            accumulator += dataMem[arg];
-            ++currentInstruct;
-            break;
-        }
-        case SUBMEM:
-        {   // subtracts dataMem[arg] to accumulator, advance 1 instruction
-            accumulator -= dataMem[arg];
-            ++currentInstruct;
-            break;
-        }
-        case MULMEM:
-        {   // multiplies dataMem[arg] to accumulator, advance 1 instruction
-            accumulator *= dataMem[arg];
-            ++currentInstruct;
-            break;
-        }
-        case DIVMEM:
-        {   // divides dataMem[arg] to accumulator, advance 1 instruction
-            accumulator /= dataMem[arg];
-            ++currentInstruct;
-            break;
-        }
-        case JUMPREL:
-        {   // advances the instruction set by [arg] (CAN be negative)
-            if (arg == 0)
-                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
-            else
-            {
-                instructMem.advance(currentInstruct, arg);
-                break;
-            }
-        }
-        case JUMPZERO:
-        {   // if accumulator == 0, advance instruction set by [arg], otherwise advance by 1
-            if (arg == 0)
-                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
-            else
-            {
-                if (accumulator == 0)
-                {
-                    instructMem.advance(currentInstruct, arg);
-                    break;
-                }
-                else
-                {
-                    ++currentInstruct;
-                    break;
-                }
-            }
-        }
-        case JUMPNZERO:
-        {   // if accumulator != 0, advance instruction set by [arg], otherwise advance by 1
-            if (arg == 0)
-                throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
-            else
-            {
-                if (accumulator != 0)
-                {
-                    instructMem.advance(currentInstruct, arg);
-                    break;
-                }
-                else
-                {
-                    ++currentInstruct;
-                    break;
-                }
-            }   
-        }
-        case NOOP:
-        {   // advance 1 instruction
-            ++currentInstruct;
-            break;
-        }
-        case HALT:
-        {  // Set status to HALTED, advance 1 instruction
-            machineStatus = HALTED;
-            ++currentInstruct;
-            break;
-        }
-        case OUTPUT:
-        {   // Output accumulator to std::out, advance 1 instruction
-            std::cout << accumulator << std::endl;
-            ++currentInstruct;
-            break;
-        }
-        case CHECKMEM:
-        {   // checks if DM is of size [arg]. If not, status = ERRORED. Advance 1 instruction
-            int size = static_cast<int>(dataMem.size());
-            ++currentInstruct;
-            if (size < arg)
-            {
-                machineStatus = ERRORED;
-                break;
-            }
-            else
-            {
-                break;
-            }
-        }
-        default:
-            throw std::invalid_argument("Instruction not found");
-    }
-}
-
 // loads in a GritVM program at [filename], with initial data [initialMemory]
-// Loads instruction set into instructMem, loads [initialMemory] into dataMem
+// .gvm files are parsed with GVMParser, .gvmb files are memory-mapped (see BytecodeImage.hpp)
 // Sets machineStatus based on success when loading GritVM program
 STATUS GritVM::load(const std::string filename, const std::vector<long> &initialMemory)
 {
     // If machine status is anything other than WAITING, return current status
-    if (machineStatus != WAITING)
-        return machineStatus;
-
-    // open [filename] file
-    std::ifstream program(filename);
-
-    // if file failed to open, throw error
-    if (!program)
-        throw std::runtime_error(filename + " could not be opened");
+    if (context.status() != WAITING)
+        return context.status();
 
-    //read each line in .gvm file
-    std::string line;
-    while (std::getline(program, line))
-    {
-        // if line empty or first character is #, skip to next line
-        char firstChar = line[0];
-        if (line.empty() || firstChar == '#')
-            continue;
-
-        // parse new instruction from line
-        Instruction new_instruction = GVMHelper::parseInstruction(line);
+    // throws if the file cannot be opened
+    loaded = GritProgram::fromFile(filename, fusion);
+    return context.attach(loaded, initialMemory);
+}
 
-        // if instruction not recognized, change the machine status to ERRORED and return
-        if (new_instruction.operation == UNKNOWN_INSTRUCTION)
-        {
-            machineStatus = ERRORED;
-            return machineStatus;
-        }
+// loads in a compiled .gvmb program at [filename] whatever its extension, with initial data [initialMemory]
+// Sets machineStatus to ERRORED if the file is not a valid .gvmb file
+STATUS GritVM::loadBinary(const std::string filename, const std::vector<long> &initialMemory)
+{
+    // If machine status is anything other than WAITING, return current status
+    if (context.status() != WAITING)
+        return context.status();
 
-        // add instruction to instructMem list
-        instructMem.push_back(new_instruction);
-    }
-    program.close();
+    // throws if the file cannot be opened
+    loaded = GritProgram::fromBytecode(filename, fusion);
+    return context.attach(loaded, initialMemory);
+}
 
-    // if the intructMem size is 0, status = WAITING. Else, status = READY
-    machineStatus = instructMem.size() == 0 ? WAITING : READY;
+// loads in a GritVM program at [filename] (.gvm or .gvmb) with its data memory held in [memoryFile], on the
+// PAGED_MEMORY layout: the memory starts as the file's contents and what the program leaves there persists
+// (see GritContext::attachMemoryFile). Throws if either file cannot be opened
+STATUS GritVM::loadWithMemoryFile(const std::string filename, const std::string memoryFile)
+{
+    // If machine status is anything other than WAITING, return current status
+    if (context.status() != WAITING)
+        return context.status();
 
-    // copy the vector passed into the load method to the dataMem vector
-    for (long elem : initialMemory)
-        dataMem.push_back(elem);
-    
-    // set current instruction to be first in instruction set
-    currentInstruct = instructMem.begin();
+    // throws if the file cannot be opened
+    loaded = GritProgram::fromFile(filename, fusion);
+    return context.attachMemoryFile(loaded, memoryFile);
+}
 
-    //return the current status
-    return machineStatus;
+// line, column and message of the last text parse failure
+const ParseError& GritVM::getLoadError() const
+{
+    static const ParseError none;
+    return loaded ? loaded->getLoadError() : none;
 }
 
 // Runs the GritVM program currently loaded into object memory until machine status is valid
 // Returns machineStatus when program terminates
 STATUS GritVM::run()
 {
-    // if not READY, return current status
-    if (machineStatus != READY)
-        return machineStatus;
+    return context.run(engine);
+}
 
-    machineStatus = RUNNING;
-    // while not on the last instruction
-    while(currentInstruct != instructMem.end())
-    {
-        // execute current instruction if status is RUNNING
-        if (machineStatus == RUNNING)
-            evaluateInstruction(*currentInstruct);
-        else
-            break;
-    }
+// Runs (or resumes) the loaded program for at most [budget] instructions. Returns RUNNING if it has not
+// ended yet; calling run(), runFor() or runUntil() again continues it
+STATUS GritVM::runFor(unsigned long long budget)
+{
+    return context.runFor(budget, engine);
+}
 
-    machineStatus = HALTED;
-    return machineStatus;
+// Runs (or resumes) the loaded program until it ends or [deadline] passes, see runFor()
+STATUS GritVM::runUntil(std::chrono::steady_clock::time_point deadline)
+{
+    return context.runUntil(deadline, engine);
 }
 
 // returns a copy of the current dataMem
 std::vector<long> GritVM::getDataMem()
 {
-    std::vector<long> to_return;
+    return context.getDataMem();
+}
+
+// copies the current dataMem into [out], reusing its storage instead of returning a new vector
+void GritVM::copyDataMem(std::vector<long>& out) const
+{
+    context.copyDataMem(out);
+}
 
-    // copy custom dataMem vector to STL vector for return value
-    for (int i = 0; i < dataMem.size(); ++i)
-        to_return.push_back(dataMem[i]);
+// Prepares the already loaded program to run again on [initialMemory], without reloading it
+STATUS GritVM::restart(const std::vector<long> &initialMemory)
+{
+    return context.restart(initialMemory);
+}
 
-    return to_return;
+// Replaces the loaded program and the state with those of [snap], returns the restored status
+STATUS GritVM::restore(std::shared_ptr<const GritSnapshot> snap)
+{
+    loaded = snap->getProgram();
+    return context.restore(snap);
 }
 
-// Sets the accumulator to 0, clears the dataMem and instructMem, sets the machine status to WAITING
+// Returns a new GritVM holding this one's program and state, e.g. to try several continuations from a
+// common prefix of execution. Engine, fusion, memory layout, bounds and arithmetic checking are carried over; the
+// profiler, tracer and output sink are not
+std::unique_ptr<GritVM> GritVM::fork()
+{
+    std::unique_ptr<GritVM> child(new GritVM());
+    child->engine = engine;
+    child->fusion = fusion;
+    child->context.setMemoryLayout(context.getMemoryLayout());
+    child->context.setBoundsChecking(context.getBoundsChecking());
+    child->context.setCheckedArithmetic(context.getCheckedArithmetic());
+    child->restore(context.snapshot());
+    return child;
+}
+
+// Sets the accumulator to 0, clears the dataMem and the loaded program, sets the machine status to WAITING
 STATUS GritVM::reset()
 {
-    accumulator = 0;
-    dataMem.clear();
-    instructMem.clear();
-    machineStatus = WAITING;
+    context.reset();
+    loaded.reset();
+
+    return context.status();
+}
 
-    return machineStatus;
+// handler entries the threaded engine dispatches through for the loaded program
+int GritVM::decodedSize() const
+{
+    return loaded ? loaded->decoded().entries() : 0;
 }
 
 // prints the current GritVM object data[if printData == true] and the instruction set stored in memory[if printInstruction == true]
@@ -293,30 +148,22 @@ void GritVM::printVM(bool printData, bool printInstruction)
 {
     // print current status and accumulator
     std::cout << "****** Output Dump ******" << std::endl;
-    std::cout << "Status: " << GVMHelper::statusToString(machineStatus) << std::endl;
-    std::cout << "Accumulator: " << accumulator << std::endl;
+    std::cout << "Status: " << GVMHelper::statusToString(context.status()) << std::endl;
+    std::cout << "Accumulator: " << context.getAccumulator() << std::endl;
     if (printData)
     {   // if true, print contents of dataMem
         std::cout << "*** Data Memory ***" << std::endl;
-        int index = 0;
-        CustomVector<long>::Iterator it = dataMem.begin();
-        while (it != dataMem.end())
-        {
-            long item = (*it);
-            std::cout << "Location " << index++ << ": " << item << std::endl;
-            ++it;
-        }
+        std::vector<long> dataMem = context.getDataMem();
+        for (size_t index = 0; index < dataMem.size(); ++index)
+            std::cout << "Location " << index << ": " << dataMem[index] << std::endl;
     }
-    if (printInstruction)
-    {   // if true, print contents of instructMem
+    if (printInstruction && loaded)
+    {   // if true, print contents of the loaded program
         std::cout << "*** Instruction Memory ***" << std::endl;
-        int index = 0;
-        DLinkedList::Iterator it = instructMem.begin();
-        while (it != instructMem.end())
+        for (int index = 0; index < loaded->size(); ++index)
         {
-            Instruction item = (*it);
-            std::cout << "Instruction " << index++ << ": " << GVMHelper::instructionToString(item.operation) << " " << item.argument << std::endl;
-            ++it;
+            Instruction item = loaded->data()[index];
+            std::cout << "Instruction " << index << ": " << GVMHelper::instructionToString(item.operation) << " " << item.argument << std::endl;
         }
     }
-}
\ No newline at end of file
+}
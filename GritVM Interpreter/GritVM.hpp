@@ -5,6 +5,10 @@
  *              the GritVM programming language. It can read in a file of code
  *              written in GritVM, run the instructions, and hold the results
  *              in object memory.
+ *
+ *              GritVM pairs one loaded GritProgram with one GritContext. To
+ *              run a program on several threads at once, share the
+ *              GritProgram between several GritContexts instead.
  * 
  *              See implementation file for function descriptions
  * *********************************************************************/
@@ -13,32 +17,63 @@
 #define GRITVM_H
 
 #include "GritVMBase.hpp"
-#include "DLinkedList.hpp"
 #include "CustomVector.hpp"
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>  // required from abstract class
 
 class GritVM : public GritVMInterface
 {
     private:
-        CustomVector<long> dataMem;                              // Vector ADT that holds the data memory for a program
-        DLinkedList instructMem;                                 // Doubley-linked list that holds the list of instructions
-        DLinkedList::Iterator currentInstruct;                   // Iterator that tracks the current instruction
-        STATUS machineStatus;                                    // Holds the current status of the program
-        long accumulator;                                        // Works as the accumulator for the GritVM - stores temp values for calculation 
-
-        void evaluateInstruction(const Instruction& instruct);   // takes Instruction object as parameter, evaluates it and alters data members as necessary
+        std::shared_ptr<const GritProgram> loaded;               // The loaded program, shareable with other contexts
+        GritContext context;                                     // Data memory, accumulator, program counter and status
+        ENGINE engine;                                           // engine used by run()
+        bool fusion;                                             // if true, load() fuses common sequences into superinstructions
 
     public:
-        GritVM() : currentInstruct( instructMem.begin() ), machineStatus(WAITING), accumulator(0){};
+        GritVM() : engine(SWITCH_ENGINE), fusion(true){};
 
         virtual STATUS load(const std::string filename, const std::vector<long>& initialMemory);
+        STATUS loadBinary(const std::string filename, const std::vector<long>& initialMemory);
+        STATUS loadWithMemoryFile(const std::string filename, const std::string memoryFile);  // data memory kept in [memoryFile]
+        const ParseError& getLoadError() const;                  // line, column and message of the last parse failure
         virtual STATUS run();
+        STATUS runFor(unsigned long long budget);                // time-sliced run(), see GritContext.hpp
+        STATUS runUntil(std::chrono::steady_clock::time_point deadline);
         virtual std::vector<long> getDataMem();
         virtual STATUS reset();
+        STATUS restart(const std::vector<long>& initialMemory);  // rewinds the loaded program onto new data memory
+        void copyDataMem(std::vector<long>& out) const;          // getDataMem() into an existing vector
+
+        std::shared_ptr<const GritSnapshot> snapshot() { return context.snapshot(); };   // see GritContext.hpp
+        STATUS restore(std::shared_ptr<const GritSnapshot> snap);   // takes the program and state of [snap]
+        std::unique_ptr<GritVM> fork();                          // a new GritVM in this state, with the same settings
+
+        std::shared_ptr<const GritProgram> getProgram() const { return loaded; };    // the loaded program, to share with other contexts
+
+        void setEngine(ENGINE e) { engine = e; };                // selects the engine used by run()
+        ENGINE getEngine() const { return engine; };
+        void setFusion(bool enabled) { fusion = enabled; };      // takes effect on the next load()
+        int decodedSize() const;                                 // handler entries the threaded engine dispatches through
+        void setMemoryLayout(MEMORY_LAYOUT layout) { context.setMemoryLayout(layout); };  // see GritContext.hpp
+        MEMORY_LAYOUT getMemoryLayout() const { return context.getMemoryLayout(); };
+        void resizeMemory(size_t cells) { context.resizeMemory(cells); };                 // see GritContext.hpp
+        void setBoundsChecking(bool enabled) { context.setBoundsChecking(enabled); };     // see GritContext.hpp
+        bool getBoundsChecking() const { return context.getBoundsChecking(); };
+        void setCheckedArithmetic(bool enabled) { context.setCheckedArithmetic(enabled); }; // see GritContext.hpp
+        bool getCheckedArithmetic() const { return context.getCheckedArithmetic(); };
+        const ArithmeticFault& getFault() const { return context.getFault(); };
+        void setProfiler(GVMProfiler* profiler) { context.setProfiler(profiler); };       // see GritContext.hpp
+        GVMProfiler* getProfiler() const { return context.getProfiler(); };
+        void setTracer(GVMTracer* tracer) { context.setTracer(tracer); };                 // see GritContext.hpp
+        GVMTracer* getTracer() const { return context.getTracer(); };
+        void setOutput(OutputSink* sink) { context.setOutput(sink); };                    // see GritContext.hpp
+        OutputSink* getOutput() const { return context.getOutput(); };
 
         void printVM(bool printData, bool printInstruction);
 };
 
-#endif /* GRITVM_H */
\ No newline at end of file
+#endif /* GRITVM_H */
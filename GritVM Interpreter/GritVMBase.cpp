@@ -37,6 +37,12 @@ std::string GVMHelper::instructionToString(INSTRUCTION_SET s) {
     case HALT:      return "HALT";
     case OUTPUT:    return "OUTPUT";
     case CHECKMEM:  return "CHECKMEM";
+    case LOADREG:   return "LOADREG";
+    case STOREREG:  return "STOREREG";
+    case ADDREG:    return "ADDREG";
+    case SUBREG:    return "SUBREG";
+    case MULREG:    return "MULREG";
+    case DIVREG:    return "DIVREG";
     default:        return "UNKNOWN_INSTRUCTION";
   }
 }
@@ -74,7 +80,13 @@ INSTRUCTION_SET GVMHelper::stringtoInstruction(std::string s) {
     { "NOOP", NOOP },
     { "HALT", HALT },
     { "OUTPUT", OUTPUT },
-    { "CHECKMEM", CHECKMEM }
+    { "CHECKMEM", CHECKMEM },
+    { "LOADREG", LOADREG },
+    { "STOREREG", STOREREG },
+    { "ADDREG", ADDREG },
+    { "SUBREG", SUBREG },
+    { "MULREG", MULREG },
+    { "DIVREG", DIVREG }
   };
   
   return (instructionSetMapping.count(s) == 0) ? UNKNOWN_INSTRUCTION : instructionSetMapping[s];
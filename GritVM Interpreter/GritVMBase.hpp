@@ -1,6 +1,7 @@
 #ifndef GRITVMBASE_H
 #define GRITVMBASE_H
 
+#include <climits>
 #include <string>
 #include <vector>
 
@@ -24,10 +25,17 @@ typedef enum _instruction_set {
   // Misc Functions
   NOOP, HALT, OUTPUT, CHECKMEM,
 
+  // Register Functions: the argument is a register index, 0 to GVM_REGISTERS - 1
+  LOADREG, STOREREG,
+  ADDREG, SUBREG, MULREG, DIVREG,
+
   // USE ONLY FOR BAD TRANSLATIONS READS (Ex: Typos in gvm file)
   UNKNOWN_INSTRUCTION
 } INSTRUCTION_SET;
 
+// Number of registers beside the accumulator. Registers start at 0 and are not part of data memory
+const int GVM_REGISTERS = 8;
+
 typedef enum _status {
   WAITING,  // Waiting to load a program 
   READY,    // Program loaded and ready to run
@@ -41,7 +49,7 @@ typedef enum _status {
 typedef struct _instruction {
   INSTRUCTION_SET operation; long argument;
 
-  _instruction(INSTRUCTION_SET i, long arg = 0) : operation(i), argument(arg) {};
+  _instruction(INSTRUCTION_SET i = UNKNOWN_INSTRUCTION, long arg = 0) : operation(i), argument(arg) {};
 } Instruction;
 
 class GritVMInterface {
@@ -58,6 +66,36 @@ namespace GVMHelper {
   std::string     instructionToString(INSTRUCTION_SET s);
   INSTRUCTION_SET stringtoInstruction(std::string s);
   Instruction     parseInstruction(std::string gvmLine);
+
+  // Overflow-checked accumulator arithmetic: each stores [a] op [b] in [result] and returns true, or returns
+  // false, leaving [result] untouched, if the result does not fit in a long or (for checkedDiv) [b] is 0
+#if defined(__GNUC__) || defined(__clang__)
+  inline bool checkedAdd(long a, long b, long& result) { long r; if (__builtin_add_overflow(a, b, &r)) return false; result = r; return true; }
+  inline bool checkedSub(long a, long b, long& result) { long r; if (__builtin_sub_overflow(a, b, &r)) return false; result = r; return true; }
+  inline bool checkedMul(long a, long b, long& result) { long r; if (__builtin_mul_overflow(a, b, &r)) return false; result = r; return true; }
+#else
+  inline bool checkedAdd(long a, long b, long& result)
+  {
+      if ((b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b)) return false;
+      result = a + b; return true;
+  }
+  inline bool checkedSub(long a, long b, long& result)
+  {
+      if ((b < 0 && a > LONG_MAX + b) || (b > 0 && a < LONG_MIN + b)) return false;
+      result = a - b; return true;
+  }
+  inline bool checkedMul(long a, long b, long& result)
+  {
+      if (a > 0 ? (b > 0 ? a > LONG_MAX / b : b < LONG_MIN / a)
+                : (b > 0 ? a < LONG_MIN / b : (a != 0 && b < LONG_MAX / a))) return false;
+      result = a * b; return true;
+  }
+#endif
+  inline bool checkedDiv(long a, long b, long& result)
+  {
+      if (b == 0 || (a == LONG_MIN && b == -1)) return false;
+      result = a / b; return true;
+  }
 };
 
 #endif /* GRITVM_H */
\ No newline at end of file
@@ -0,0 +1,379 @@
+/***********************************************************************
+ * LockstepEngine.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the LockstepEngine class, which
+ *              executes a GritVM program over several inputs in lockstep.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "LockstepEngine.hpp"
+#include "BoundsAnalysis.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <stdexcept>
+
+// The state of [W] lanes. Cell k of lane l lives at memory[k * W + l]; rows past a lane's size hold 0
+template <int W>
+struct Lanes
+{
+    long acc[W];
+    long reg[GVM_REGISTERS * W];    // register r of lane l at reg[r * W + l]
+    long pc[W];
+    long live[W];           // 1 while the lane has not ended
+    long size[W];           // number of cells in the lane's data memory
+    long rows;              // cells per lane memory has room for
+    std::vector<long> memory;
+
+    // makes room for at least [n] cells in every lane
+    void reserveRows(long n)
+    {
+        if (n <= rows)
+            return;
+        rows = std::max(n, 2 * rows);
+        memory.resize(static_cast<size_t>(rows) * W, 0);
+    }
+};
+
+// throws if a lane in [mask] accesses cell [arg] of a data memory too small for it
+template <int W>
+static void checkAccess(const Lanes<W>& lanes, const long* mask, long arg)
+{
+    long bad = 0;
+    for (int l = 0; l < W; ++l)
+        bad |= mask[l] & (arg < 0 || arg >= lanes.size[l]);
+    if (bad)
+        throw std::out_of_range("Data memory access out of bounds");
+}
+
+// returns the row of register [index] in [lanes], throwing as GritContext does for an index outside the register file
+template <int W>
+static long* registerRow(Lanes<W>& lanes, long index)
+{
+    if (index < 0 || index >= GVM_REGISTERS)
+        throw std::out_of_range("Invalid Register. Index is outside of the register file");
+    return &lanes.reg[index * W];
+}
+
+// returns the target of the jump at [pc] with argument [arg], throwing as GritContext::jump() does
+static long jumpTarget(long pc, long arg, long programSize)
+{
+    long target = pc + arg;
+    if (target < 0 || target > programSize)
+        throw std::out_of_range("Invalid Jump Command. Target is outside of instruction memory");
+    return target;
+}
+
+// runs [program] over the [count] (at most [W]) inputs at [inputs], see LockstepEngine::run()
+template <int W>
+static void runLanes(const GritProgram& program, const std::vector<long>* inputs, std::vector<long>* outputs, STATUS* statuses,
+                     size_t count, OutputSink& sink)
+{
+    const Instruction* code = program.data();
+    const long programSize = program.size();
+
+    Lanes<W> lanes;
+    lanes.rows = 0;
+    long widest = 0;
+    for (size_t l = 0; l < count; ++l)
+        widest = std::max(widest, static_cast<long>(inputs[l].size()));
+    lanes.reserveRows(widest);
+    std::fill(lanes.reg, lanes.reg + GVM_REGISTERS * W, 0);
+    for (int l = 0; l < W; ++l)
+    {
+        bool used = (static_cast<size_t>(l) < count);
+        lanes.acc[l] = 0;
+        lanes.pc[l] = 0;
+        lanes.live[l] = (used && programSize > 0) ? 1 : 0;
+        lanes.size[l] = used ? static_cast<long>(inputs[l].size()) : 0;
+        for (long k = 0; k < lanes.size[l]; ++k)
+            lanes.memory[k * W + l] = inputs[l][k];
+    }
+
+    const BoundsAnalysis& bounds = program.bounds();
+    std::vector<long> printed;
+
+    // While the lanes agree, they all run at [cur] and [mask] is simply the live lanes. Once a branch
+    // splits them, each lane's program counter is kept in pc[] and every step runs the lowest one
+    long mask[W];
+    long cur = 0;
+    bool split = false;
+    bool anyLive = false;
+    for (int l = 0; l < W; ++l)
+    {
+        mask[l] = lanes.live[l];
+        anyLive = anyLive || lanes.live[l];
+    }
+
+    // returns row [index] of memory, after checking the lanes in [mask] if BoundsAnalysis could not prove the access
+    auto rowAt = [&](long index) {
+        if (bounds.needsCheck(cur))
+            checkAccess(lanes, mask, index);
+        return &lanes.memory[index * W];
+    };
+
+    while (anyLive)
+    {
+        if (split)
+        {   // the lanes at the lowest program counter run next; the rest wait for them
+            cur = LONG_MAX;
+            for (int l = 0; l < W; ++l)
+                cur = (lanes.live[l] && lanes.pc[l] < cur) ? lanes.pc[l] : cur;
+            for (int l = 0; l < W; ++l)
+                mask[l] = lanes.live[l] & (lanes.pc[l] == cur);
+        }
+
+        const Instruction& instruct = code[cur];
+        const long arg = instruct.argument;
+        long* row = nullptr;
+        long next = cur + 1;    // where the lanes in [mask] continue, unless a jump splits them
+
+        switch (instruct.operation)
+        {
+            case CLEAR:
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? 0 : lanes.acc[l];
+                break;
+            case AT:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? row[l] : lanes.acc[l];
+                break;
+            case SET:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                    row[l] = mask[l] ? lanes.acc[l] : row[l];
+                break;
+            case INSERT:
+                for (int l = 0; l < W; ++l)
+                {   // each lane's memory shifts on its own; cells past a lane's end stay 0
+                    if (!mask[l])
+                        continue;
+                    if (arg < 0 || arg > lanes.size[l])
+                        throw std::out_of_range("Data memory access out of bounds");
+                    lanes.reserveRows(lanes.size[l] + 1);
+                    for (long k = lanes.size[l]; k > arg; --k)
+                        lanes.memory[k * W + l] = lanes.memory[(k - 1) * W + l];
+                    lanes.memory[arg * W + l] = lanes.acc[l];
+                    ++lanes.size[l];
+                }
+                break;
+            case ERASE:
+                rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                {
+                    if (!mask[l])
+                        continue;
+                    for (long k = arg; k + 1 < lanes.size[l]; ++k)
+                        lanes.memory[k * W + l] = lanes.memory[(k + 1) * W + l];
+                    --lanes.size[l];
+                    lanes.memory[lanes.size[l] * W + l] = 0;
+                }
+                break;
+            case ADDCONST:
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] + arg : lanes.acc[l];
+                break;
+            case SUBCONST:
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] - arg : lanes.acc[l];
+                break;
+            case MULCONST:
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] * arg : lanes.acc[l];
+                break;
+            case DIVCONST:
+                for (int l = 0; l < W; ++l)
+                {   // masked lanes divide by 1, so they cannot trap
+                    long divisor = mask[l] ? arg : 1;
+                    lanes.acc[l] = lanes.acc[l] / divisor;
+                }
+                break;
+            case ADDMEM:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] + row[l] : lanes.acc[l];
+                break;
+            case SUBMEM:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] - row[l] : lanes.acc[l];
+                break;
+            case MULMEM:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] * row[l] : lanes.acc[l];
+                break;
+            case DIVMEM:
+                row = rowAt(arg);
+                for (int l = 0; l < W; ++l)
+                {
+                    long divisor = mask[l] ? row[l] : 1;
+                    lanes.acc[l] = lanes.acc[l] / divisor;
+                }
+                break;
+            case LOADREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? row[l] : lanes.acc[l];
+                break;
+            case STOREREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                    row[l] = mask[l] ? lanes.acc[l] : row[l];
+                break;
+            case ADDREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] + row[l] : lanes.acc[l];
+                break;
+            case SUBREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] - row[l] : lanes.acc[l];
+                break;
+            case MULREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                    lanes.acc[l] = mask[l] ? lanes.acc[l] * row[l] : lanes.acc[l];
+                break;
+            case DIVREG:
+                row = registerRow(lanes, arg);
+                for (int l = 0; l < W; ++l)
+                {
+                    long divisor = mask[l] ? row[l] : 1;
+                    lanes.acc[l] = lanes.acc[l] / divisor;
+                }
+                break;
+            case JUMPREL:
+            case JUMPZERO:
+            case JUMPNZERO:
+            {
+                if (arg == 0)
+                    throw std::invalid_argument("Invalid Jump Command. Arg cannot equal 0");
+                long taken[W];
+                long anyTaken = 0;
+                long allTaken = 1;
+                for (int l = 0; l < W; ++l)
+                {
+                    long cond = (instruct.operation == JUMPREL) ? 1 : (instruct.operation == JUMPZERO) ? (lanes.acc[l] == 0) : (lanes.acc[l] != 0);
+                    taken[l] = mask[l] & cond;
+                    anyTaken |= taken[l];
+                    allTaken &= taken[l] | !mask[l];
+                }
+                if (!anyTaken)
+                    break;
+                long target = jumpTarget(cur, arg, programSize);
+                if (allTaken)
+                {
+                    next = target;
+                    break;
+                }
+
+                // the lanes disagree: each now follows its own program counter
+                for (int l = 0; l < W; ++l)
+                    lanes.pc[l] = taken[l] ? target : (mask[l] ? cur + 1 : lanes.pc[l]);
+                split = true;
+                next = -1;
+                break;
+            }
+            case NOOP:
+                break;
+            case HALT:
+                next = programSize;     // ends the lanes in [mask]
+                break;
+            case OUTPUT:
+                for (int l = 0; l < W; ++l)
+                {
+                    if (mask[l])
+                        printed.push_back(lanes.acc[l]);
+                }
+                break;
+            case CHECKMEM:
+                anyLive = false;
+                for (int l = 0; l < W; ++l)
+                {
+                    lanes.live[l] &= !(mask[l] & (lanes.size[l] < arg));
+                    mask[l] &= lanes.live[l];
+                    anyLive = anyLive || lanes.live[l];
+                }
+                break;
+            default:
+                throw std::invalid_argument("Instruction not found");
+        }
+
+        if (next < 0)
+            ;   // a jump has just split the lanes and set their program counters
+        else if (!split)
+        {   // every lane moves on together; running off the end (or HALT) ends them all
+            cur = next;
+            if (cur >= programSize)
+            {
+                for (int l = 0; l < W; ++l)
+                    lanes.live[l] = 0;
+                anyLive = false;
+            }
+            continue;
+        }
+        else
+        {
+            for (int l = 0; l < W; ++l)
+                lanes.pc[l] = mask[l] ? next : lanes.pc[l];
+        }
+
+        // with the lanes split: lanes past the end stop, and once all the others meet again they run together
+        long meet = -1;
+        bool together = true;
+        anyLive = false;
+        for (int l = 0; l < W; ++l)
+        {
+            lanes.live[l] &= (lanes.pc[l] < programSize);
+            if (!lanes.live[l])
+                continue;
+            together = together && (meet < 0 || lanes.pc[l] == meet);
+            meet = lanes.pc[l];
+            anyLive = true;
+        }
+        if (together && anyLive)
+        {
+            split = false;
+            cur = meet;
+            for (int l = 0; l < W; ++l)
+                mask[l] = lanes.live[l];
+        }
+    }
+
+    if (!printed.empty())
+    {
+        sink.write(printed.data(), printed.size());
+        sink.flush();
+    }
+
+    for (size_t l = 0; l < count; ++l)
+    {
+        outputs[l].resize(lanes.size[l]);
+        for (long k = 0; k < lanes.size[l]; ++k)
+            outputs[l][k] = lanes.memory[k * W + l];
+        statuses[l] = HALTED;   // run() always ends HALTED, including after a failed CHECKMEM
+    }
+}
+
+// runs the inputs through runLanes() in groups of [width], see header
+void LockstepEngine::run(const GritProgram& program, const std::vector<long>* inputs, std::vector<long>* outputs, STATUS* statuses,
+                         size_t count, unsigned width, OutputSink* sink)
+{
+    static StreamSink standardOutput(std::cout);
+    OutputSink& out = sink ? *sink : standardOutput;
+    width = (width <= 4) ? 4 : 8;
+
+    for (size_t first = 0; first < count; first += width)
+    {
+        size_t group = std::min<size_t>(width, count - first);
+        if (width == 4)
+            runLanes<4>(program, inputs + first, outputs + first, statuses + first, group, out);
+        else
+            runLanes<8>(program, inputs + first, outputs + first, statuses + first, group, out);
+    }
+}
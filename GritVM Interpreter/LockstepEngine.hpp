@@ -0,0 +1,47 @@
+/***********************************************************************
+ * LockstepEngine.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the LockstepEngine class, which runs one
+ *              GritVM program over 4 or 8 inputs at once, one input per
+ *              lane, executing each instruction for every lane together.
+ *
+ *              The lanes' data memories are interleaved (cell k of every
+ *              lane is adjacent), as are their registers, and accumulator
+ *              arithmetic, AT, SET and the *MEM and *REG instructions are
+ *              fixed-width loops over the lanes that the compiler turns
+ *              into SIMD (AVX2 when configured with -DGVM_LOCKSTEP_AVX2=ON,
+ *              which needs an AVX2 CPU to run). Lanes whose branches
+ *              diverge get their own program counters: each step executes
+ *              the lowest program counter of any live lane for the lanes
+ *              that are there, with the others masked off, so lanes
+ *              reconverge as soon as they meet again.
+ *              INSERT and ERASE shift each lane's memory one lane at a time.
+ *
+ *              Results match running every input on its own GritContext,
+ *              except that OUTPUT values of different lanes interleave, and
+ *              an access outside a lane's data memory, which is undefined
+ *              for the other engines, throws std::out_of_range here.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef LOCKSTEPENGINE_H
+#define LOCKSTEPENGINE_H
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "OutputSink.hpp"
+
+#include <vector>
+
+class LockstepEngine
+{
+    public:
+        // runs [program], which must be READY, over inputs[0 .. count), [width] lanes (4 or 8) at a time, leaving the
+        // resulting data memories in outputs[0 .. count) and the final statuses in statuses[0 .. count). OUTPUT
+        // values go to [sink], std::cout if nullptr. Throws what the program throws, as the other engines do
+        static void run(const GritProgram& program, const std::vector<long>* inputs, std::vector<long>* outputs, STATUS* statuses,
+                        size_t count, unsigned width = 8, OutputSink* sink = nullptr);
+};
+
+#endif // LOCKSTEPENGINE_H
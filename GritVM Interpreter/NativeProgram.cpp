@@ -0,0 +1,397 @@
+/***********************************************************************
+ * NativeProgram.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the NativeProgram class. Each GritVM
+ *              instruction is expanded into a fixed x86-64 template; relative
+ *              jumps become native jumps patched once every instruction's
+ *              address is known.
+ *
+ *              Register use inside generated code:
+ *                  rbx - accumulator          r12 - data memory base
+ *                  r13 - JitContext*          rax, rcx, rdx - scratch
+ *                  r8, r9, r10, r11, rsi, rdi - GVM registers 0 to 5, saved
+ *                  to the JitContext around helper calls
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "NativeProgram.hpp"
+
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define GVM_JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef GVM_JIT_X86_64
+
+static_assert(offsetof(JitContext, accumulator) == 0, "native code reads the accumulator at [ctx + 0]");
+static_assert(offsetof(JitContext, memory) == 8, "native code reads the memory base at [ctx + 8]");
+
+typedef std::vector<unsigned char> CodeBuffer;
+
+// a rel32 field at [position] that must point at label [target]
+typedef struct _fixup {
+  size_t position; long target;
+} Fixup;
+
+static void emit(CodeBuffer& buf, std::initializer_list<unsigned char> bytes)
+{
+    buf.insert(buf.end(), bytes);
+}
+
+static void emit32(CodeBuffer& buf, int32_t value)
+{
+    unsigned char bytes[4];
+    std::memcpy(bytes, &value, 4);
+    buf.insert(buf.end(), bytes, bytes + 4);
+}
+
+static void emit64(CodeBuffer& buf, int64_t value)
+{
+    unsigned char bytes[8];
+    std::memcpy(bytes, &value, 8);
+    buf.insert(buf.end(), bytes, bytes + 8);
+}
+
+static bool fitsInt32(long value)
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// emits a rel32 placeholder that will be patched to jump to label [target]
+static void emitTarget(CodeBuffer& buf, std::vector<Fixup>& fixups, long target)
+{
+    fixups.push_back(Fixup{buf.size(), target});
+    emit32(buf, 0);
+}
+
+// emits [opcode] (REX.W+B prefixed) with ModRM reg field [reg] and a memory operand addressing
+// data memory cell [index], i.e. qword [r12 + index * 8]. The full index is used, as the interpreters
+// index CustomVector with a size_t
+static void emitMemOp(CodeBuffer& buf, std::initializer_list<unsigned char> opcode, int reg, long index)
+{
+    long cell = index;
+    if (cell >= INT32_MIN / 8 && cell <= INT32_MAX / 8)
+    {   // [r12 + disp32]
+        emit(buf, {0x49});
+        emit(buf, opcode);
+        emit(buf, {static_cast<unsigned char>(0x84 | (reg << 3)), 0x24});
+        emit32(buf, static_cast<int32_t>(cell * 8));
+    }
+    else
+    {   // mov rcx, cell ; [r12 + rcx * 8]
+        emit(buf, {0x48, 0xB9});
+        emit64(buf, cell);
+        emit(buf, {0x49});
+        emit(buf, opcode);
+        emit(buf, {static_cast<unsigned char>(0x04 | (reg << 3)), 0xCC});
+    }
+}
+
+// returns the x86-64 register number GVM register [index] is kept in, or -1 if it stays in JitContext::registers
+static int machineRegister(long index)
+{
+    static const int mapped[] = { 8, 9, 10, 11, 6, 7 };     // r8, r9, r10, r11, rsi, rdi
+    return (index < 6) ? mapped[index] : -1;
+}
+
+// displacement of GVM register [index] from the JitContext
+static int32_t registerOffset(long index)
+{
+    return static_cast<int32_t>(offsetof(JitContext, registers) + index * sizeof(long));
+}
+
+// emits [opcode] (REX.W prefixed) with ModRM reg field [reg] and GVM register [index] as the r/m operand: the
+// machine register holding it, or qword [r13 + offset] for a register kept in the JitContext
+static void emitRegOp(CodeBuffer& buf, std::initializer_list<unsigned char> opcode, int reg, long index)
+{
+    int hw = machineRegister(index);
+    if (hw >= 0)
+    {
+        emit(buf, {static_cast<unsigned char>(0x48 | (hw >> 3))});
+        emit(buf, opcode);
+        emit(buf, {static_cast<unsigned char>(0xC0 | (reg << 3) | (hw & 7))});
+    }
+    else
+    {
+        emit(buf, {0x49});
+        emit(buf, opcode);
+        emit(buf, {static_cast<unsigned char>(0x85 | (reg << 3))});
+        emit32(buf, registerOffset(index));
+    }
+}
+
+// emits loads ([load] true) or stores between the GVM registers kept in machine registers and the JitContext
+static void emitRegisterSync(CodeBuffer& buf, bool load)
+{
+    for (long index = 0; index < GVM_REGISTERS; ++index)
+    {
+        int hw = machineRegister(index);
+        if (hw < 0)
+            continue;
+        emit(buf, {static_cast<unsigned char>(0x49 | ((hw >> 3) << 2)), static_cast<unsigned char>(load ? 0x8B : 0x89),
+                   static_cast<unsigned char>(0x85 | ((hw & 7) << 3))});      // mov reg, [r13 + offset] / mov [r13 + offset], reg
+        emit32(buf, registerOffset(index));
+    }
+}
+
+// emits mov qword [r13 + offset], [index]: records in JitContext::instruction the instruction about to call a
+// helper or stop the program, where the interpreters would leave the program counter
+static void emitInstructionIndex(CodeBuffer& buf, long index)
+{
+    emit(buf, {0x49, 0xC7, 0x85});
+    emit32(buf, static_cast<int32_t>(offsetof(JitContext, instruction)));
+    emit32(buf, static_cast<int32_t>(index));
+}
+
+// emits mov eax, [code] ; jmp epilogue, recording instruction [index] first
+static void emitExit(CodeBuffer& buf, std::vector<Fixup>& fixups, long epilogue, int code, long index)
+{
+    emitInstructionIndex(buf, index);
+    emit(buf, {0xB8});
+    emit32(buf, code);
+    emit(buf, {0xE9});
+    emitTarget(buf, fixups, epilogue);
+}
+
+// emits a call to [helper](ctx, [arg]) for instruction [index]; leaves the program with the helper's code if non-zero.
+// If [saveRegisters], the GVM registers kept in caller-saved machine registers are stored before the call and
+// reloaded after it
+static void emitHelperCall(CodeBuffer& buf, std::vector<Fixup>& fixups, long epilogue, JitHelper helper, long arg, long index,
+                           bool saveRegisters)
+{
+    emitInstructionIndex(buf, index);
+    if (saveRegisters)
+        emitRegisterSync(buf, false);
+    emit(buf, {0x49, 0x89, 0x5D, 0x00});                            // mov [r13 + 0], rbx
+    emit(buf, {0x4C, 0x89, 0xEF});                                  // mov rdi, r13
+    emit(buf, {0x48, 0xBE}); emit64(buf, arg);                      // mov rsi, arg
+    emit(buf, {0x48, 0xB8});
+    emit64(buf, static_cast<int64_t>(reinterpret_cast<intptr_t>(helper)));  // mov rax, helper
+    emit(buf, {0xFF, 0xD0});                                        // call rax
+    emit(buf, {0x4D, 0x8B, 0x65, 0x08});                            // mov r12, [r13 + 8]
+    if (saveRegisters)
+        emitRegisterSync(buf, true);
+    emit(buf, {0x85, 0xC0});                                        // test eax, eax
+    emit(buf, {0x0F, 0x85}); emitTarget(buf, fixups, epilogue);     // jnz epilogue
+}
+
+// emits an accumulator operation with a constant: [op32] takes a sign extended imm32 (REX.W 81 /ext
+// or 69 for imul); larger constants go through rax with [opReg]
+static void emitConstOp(CodeBuffer& buf, std::initializer_list<unsigned char> op32, std::initializer_list<unsigned char> opReg, long constant)
+{
+    if (fitsInt32(constant))
+    {
+        emit(buf, op32);
+        emit32(buf, static_cast<int32_t>(constant));
+    }
+    else
+    {
+        emit(buf, {0x48, 0xB8}); emit64(buf, constant);             // mov rax, constant
+        emit(buf, opReg);
+    }
+}
+
+#endif // GVM_JIT_X86_64
+
+// true if this host can run generated code
+bool NativeProgram::supported()
+{
+#ifdef GVM_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+// translates the [count] instructions at [program] into native code, replacing any previous program. [helpers] are called
+// for the instructions that are not generated inline. Returns false if the host is unsupported or
+// executable memory could not be mapped
+bool NativeProgram::compile(const Instruction* program, int count, const JitHelpers& helpers)
+{
+    clear();
+
+#ifdef GVM_JIT_X86_64
+    long programSize = count;
+    long epilogue = programSize + 1;        // label of the shared epilogue
+
+    CodeBuffer buf;
+    std::vector<Fixup> fixups;
+    std::vector<size_t> labels(programSize + 2, 0);
+
+    // the GVM registers only need loading, saving around helper calls and storing if the program uses them
+    bool usesRegisters = false;
+    for (long i = 0; i < programSize; ++i)
+        usesRegisters = usesRegisters || (program[i].operation >= LOADREG && program[i].operation <= DIVREG);
+
+    // prologue: save callee-saved registers (the three pushes plus the return address leave rsp
+    // 16-byte aligned for helper calls), then load ctx, accumulator and memory base
+    emit(buf, {0x53, 0x41, 0x54, 0x41, 0x55});                      // push rbx ; push r12 ; push r13
+    emit(buf, {0x49, 0x89, 0xFD});                                  // mov r13, rdi
+    emit(buf, {0x49, 0x8B, 0x5D, 0x00});                            // mov rbx, [r13 + 0]
+    emit(buf, {0x4D, 0x8B, 0x65, 0x08});                            // mov r12, [r13 + 8]
+    if (usesRegisters)
+        emitRegisterSync(buf, true);
+
+    for (long i = 0; i < programSize; ++i)
+    {
+        labels[i] = buf.size();
+        long arg = program[i].argument;
+
+        switch (program[i].operation)
+        {
+            case CLEAR:     emit(buf, {0x31, 0xDB}); break;                                         // xor ebx, ebx
+            case AT:        emitMemOp(buf, {0x8B}, 3, arg); break;                                  // mov rbx, [mem]
+            case SET:       emitMemOp(buf, {0x89}, 3, arg); break;                                  // mov [mem], rbx
+            case ADDMEM:    emitMemOp(buf, {0x03}, 3, arg); break;                                  // add rbx, [mem]
+            case SUBMEM:    emitMemOp(buf, {0x2B}, 3, arg); break;                                  // sub rbx, [mem]
+            case MULMEM:    emitMemOp(buf, {0x0F, 0xAF}, 3, arg); break;                            // imul rbx, [mem]
+            case DIVMEM:
+                emit(buf, {0x48, 0x89, 0xD8, 0x48, 0x99});                                          // mov rax, rbx ; cqo
+                emitMemOp(buf, {0xF7}, 7, arg);                                                     // idiv qword [mem]
+                emit(buf, {0x48, 0x89, 0xC3});                                                      // mov rbx, rax
+                break;
+            case ADDCONST:  emitConstOp(buf, {0x48, 0x81, 0xC3}, {0x48, 0x01, 0xC3}, arg); break;   // add rbx, k
+            case SUBCONST:  emitConstOp(buf, {0x48, 0x81, 0xEB}, {0x48, 0x29, 0xC3}, arg); break;   // sub rbx, k
+            case MULCONST:  emitConstOp(buf, {0x48, 0x69, 0xDB}, {0x48, 0x0F, 0xAF, 0xD8}, arg); break;  // imul rbx, k
+            case DIVCONST:
+                emit(buf, {0x48, 0xB9}); emit64(buf, arg);                                          // mov rcx, k
+                emit(buf, {0x48, 0x89, 0xD8, 0x48, 0x99});                                          // mov rax, rbx ; cqo
+                emit(buf, {0x48, 0xF7, 0xF9});                                                      // idiv rcx
+                emit(buf, {0x48, 0x89, 0xC3});                                                      // mov rbx, rax
+                break;
+            case JUMPREL:
+            case JUMPZERO:
+            case JUMPNZERO:
+            {
+                long target = i + arg;
+                if (arg == 0)
+                {
+                    emitExit(buf, fixups, epilogue, JIT_BADJUMP, i);
+                    break;
+                }
+                if (target < 0 || target > programSize)
+                {   // leaves with JIT_BADTARGET at this jump when it is taken
+                    if (program[i].operation == JUMPZERO)
+                        emit(buf, {0x48, 0x85, 0xDB, 0x75, 0x00});                                  // test rbx, rbx ; jnz past the exit
+                    else if (program[i].operation == JUMPNZERO)
+                        emit(buf, {0x48, 0x85, 0xDB, 0x74, 0x00});                                  // test rbx, rbx ; jz past the exit
+                    size_t skip = buf.size();
+                    emitExit(buf, fixups, epilogue, JIT_BADTARGET, i);
+                    if (program[i].operation != JUMPREL)
+                        buf[skip - 1] = static_cast<unsigned char>(buf.size() - skip);
+                    break;
+                }
+
+                if (program[i].operation == JUMPREL)
+                    emit(buf, {0xE9});                                                              // jmp target
+                else if (program[i].operation == JUMPZERO)
+                    emit(buf, {0x48, 0x85, 0xDB, 0x0F, 0x84});                                      // test rbx, rbx ; jz target
+                else
+                    emit(buf, {0x48, 0x85, 0xDB, 0x0F, 0x85});                                      // test rbx, rbx ; jnz target
+                emitTarget(buf, fixups, target);
+                break;
+            }
+            case NOOP:      break;
+            case HALT:      emitExit(buf, fixups, epilogue, JIT_HALT, i); break;
+            case INSERT:    emitHelperCall(buf, fixups, epilogue, helpers.insert, arg, i, usesRegisters); break;
+            case ERASE:     emitHelperCall(buf, fixups, epilogue, helpers.erase, arg, i, usesRegisters); break;
+            case OUTPUT:    emitHelperCall(buf, fixups, epilogue, helpers.output, arg, i, usesRegisters); break;
+            case CHECKMEM:  emitHelperCall(buf, fixups, epilogue, helpers.checkmem, arg, i, usesRegisters); break;
+            case LOADREG:
+            case STOREREG:
+            case ADDREG:
+            case SUBREG:
+            case MULREG:
+            case DIVREG:
+            {
+                INSTRUCTION_SET op = program[i].operation;
+                if (arg < 0 || arg >= GVM_REGISTERS)
+                    emitExit(buf, fixups, epilogue, JIT_BADREGISTER, i);
+                else if (op == LOADREG)
+                    emitRegOp(buf, {0x8B}, 3, arg);                                                 // mov rbx, reg
+                else if (op == STOREREG)
+                    emitRegOp(buf, {0x89}, 3, arg);                                                 // mov reg, rbx
+                else if (op == ADDREG)
+                    emitRegOp(buf, {0x03}, 3, arg);                                                 // add rbx, reg
+                else if (op == SUBREG)
+                    emitRegOp(buf, {0x2B}, 3, arg);                                                 // sub rbx, reg
+                else if (op == MULREG)
+                    emitRegOp(buf, {0x0F, 0xAF}, 3, arg);                                           // imul rbx, reg
+                else
+                {
+                    emit(buf, {0x48, 0x89, 0xD8, 0x48, 0x99});                                      // mov rax, rbx ; cqo
+                    emitRegOp(buf, {0xF7}, 7, arg);                                                 // idiv reg
+                    emit(buf, {0x48, 0x89, 0xC3});                                                  // mov rbx, rax
+                }
+                break;
+            }
+            default:        emitExit(buf, fixups, epilogue, JIT_UNKNOWN, i); break;
+        }
+    }
+
+    // end of program, then the shared epilogue that stores the accumulator
+    labels[programSize] = buf.size();
+    emit(buf, {0x31, 0xC0});                                        // xor eax, eax (JIT_END)
+    emit(buf, {0xE9}); emitTarget(buf, fixups, epilogue);
+    labels[epilogue] = buf.size();
+    emit(buf, {0x49, 0x89, 0x5D, 0x00});                            // mov [r13 + 0], rbx
+    if (usesRegisters)
+        emitRegisterSync(buf, false);
+    emit(buf, {0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});                // pop r13 ; pop r12 ; pop rbx ; ret
+
+    // patch every rel32 now that all labels are known
+    for (const Fixup& fix : fixups)
+    {
+        int32_t rel = static_cast<int32_t>(static_cast<long>(labels[fix.target]) - static_cast<long>(fix.position + 4));
+        std::memcpy(&buf[fix.position], &rel, 4);
+    }
+
+    // copy into a fresh mapping and flip it from writable to executable
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t mapped = ((buf.size() + pageSize - 1) / pageSize) * pageSize;
+    void* mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return false;
+    std::memcpy(mem, buf.data(), buf.size());
+    if (mprotect(mem, mapped, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(mem, mapped);
+        return false;
+    }
+
+    code = static_cast<unsigned char*>(mem);
+    codeSize = mapped;
+    return true;
+#else
+    (void)program;
+    (void)count;
+    (void)helpers;
+    return false;
+#endif
+}
+
+// runs the compiled program from its first instruction with [ctx], returning why it stopped
+JIT_EXIT NativeProgram::run(JitContext* ctx) const
+{
+    typedef int (*Entry)(JitContext*);
+    Entry entry = reinterpret_cast<Entry>(reinterpret_cast<intptr_t>(code));
+    return static_cast<JIT_EXIT>(entry(ctx));
+}
+
+// unmaps the compiled program
+void NativeProgram::clear()
+{
+#ifdef GVM_JIT_X86_64
+    if (code != nullptr)
+        munmap(code, codeSize);
+#endif
+    code = nullptr;
+    codeSize = 0;
+}
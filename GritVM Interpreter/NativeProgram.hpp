@@ -0,0 +1,83 @@
+/***********************************************************************
+ * NativeProgram.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the NativeProgram class, a template JIT
+ *              that translates a loaded GritVM program into x86-64 machine
+ *              code in an mmap'd executable buffer. The accumulator lives
+ *              in rbx and the data memory base in r12 for the whole run,
+ *              as do the first six registers of the *REG instructions in
+ *              r8-r11, rsi and rdi (the others stay in the JitContext).
+ *              INSERT, ERASE, OUTPUT and CHECKMEM call back into the VM
+ *              through JitHelpers, since they may resize data memory.
+ *
+ *              Only available on x86-64 System V hosts (Linux, macOS);
+ *              elsewhere compile() returns false and the caller falls
+ *              back to an interpreter.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef NATIVEPROGRAM_H
+#define NATIVEPROGRAM_H
+
+#include "GritVMBase.hpp"
+
+#include <cstddef>
+#include <exception>
+
+// State shared between native code and the VM. Native code keeps [accumulator] in a register
+// and only writes it back before calling a helper or returning; helpers that resize data memory
+// must refresh [memory] before returning
+typedef struct _jit_context {
+  long accumulator;             // offset 0 - read on entry, written on exit
+  long* memory;                 // offset 8 - base of data memory
+  void* owner;                  // the VM running the code, for helpers
+  std::exception_ptr error;     // set by a helper that caught an exception (exit JIT_HELPER_THREW)
+  long instruction;             // index of the instruction that last called a helper or stopped the program
+  long registers[GVM_REGISTERS]; // register file - read on entry, written on exit
+} JitContext;
+
+// Helper called from native code with the instruction argument. Returns 0 to continue or a
+// JIT_EXIT code to stop the program
+typedef int (*JitHelper)(JitContext* ctx, long arg);
+
+typedef struct _jit_helpers {
+  JitHelper insert;
+  JitHelper erase;
+  JitHelper output;
+  JitHelper checkmem;
+} JitHelpers;
+
+// Reasons native code returns to its caller
+typedef enum _jit_exit {
+  JIT_END,                // ran past the last instruction
+  JIT_HALT,               // executed HALT
+  JIT_CHECKMEM_FAILED,    // CHECKMEM found data memory too small
+  JIT_BADJUMP,            // jump with an argument of 0
+  JIT_BADTARGET,          // jump to a target outside the program
+  JIT_UNKNOWN,            // UNKNOWN_INSTRUCTION reached
+  JIT_BADREGISTER,        // register instruction with an index outside the register file
+  JIT_HELPER_THREW        // a helper caught an exception, stored in JitContext::error
+} JIT_EXIT;
+
+class NativeProgram
+{
+    private:
+        unsigned char* code;                        // executable buffer, nullptr when nothing is compiled
+        size_t codeSize;                            // mapped size of [code] in bytes
+
+        NativeProgram(const NativeProgram&);        // owns a mapping - not copyable
+        NativeProgram& operator=(const NativeProgram&);
+
+    public:
+        NativeProgram() : code(nullptr), codeSize(0) {};
+        ~NativeProgram() { clear(); };
+
+        static bool supported();                    // true if this host can run generated code
+        bool compile(const Instruction* program, int count, const JitHelpers& helpers);
+        JIT_EXIT run(JitContext* ctx) const;        // runs the compiled program from its first instruction
+        bool ready() const { return code != nullptr; };
+        void clear();                               // unmaps the compiled program
+};
+
+#endif // NATIVEPROGRAM_H
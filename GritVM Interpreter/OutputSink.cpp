@@ -0,0 +1,88 @@
+/***********************************************************************
+ * OutputSink.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the OutputSink classes, which
+ *              receive the values GritVM programs OUTPUT.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "OutputSink.hpp"
+
+#include <stdexcept>
+
+// FileSink writes its pending text to the file once it grows past this many bytes
+static const size_t FILE_SINK_BUFFER = 1 << 16;
+
+// formats [count] values one per line onto the end of [out], without going through a stream
+static void appendValues(std::string& out, const long* values, size_t count)
+{
+    char digits[24];
+    for (size_t i = 0; i < count; ++i)
+    {
+        // digits are produced backwards from the magnitude; unsigned so LONG_MIN negates safely
+        unsigned long magnitude = (values[i] < 0) ? 0ul - static_cast<unsigned long>(values[i]) : static_cast<unsigned long>(values[i]);
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        do
+        {
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (values[i] < 0)
+            *--p = '-';
+        out.append(p, end);
+        out.push_back('\n');
+    }
+}
+
+// writes the block as one string
+void StreamSink::write(const long* values, size_t count)
+{
+    std::string text;
+    appendValues(text, values, count);
+    stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void StreamSink::flush()
+{
+    stream.flush();
+}
+
+// opens [filename] for writing, see header
+FileSink::FileSink(const std::string& filename) : file(filename, std::ios::trunc)
+{
+    if (!file)
+        throw std::runtime_error(filename + " could not be opened");
+}
+
+// writes whatever is still pending
+FileSink::~FileSink()
+{
+    flush();
+}
+
+// formats the block into the pending text, writing it out once it is large
+void FileSink::write(const long* values, size_t count)
+{
+    appendValues(pending, values, count);
+    if (pending.size() >= FILE_SINK_BUFFER)
+    {
+        file.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        pending.clear();
+    }
+}
+
+void FileSink::flush()
+{
+    file.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+    pending.clear();
+    file.flush();
+}
+
+// calls the function once per value
+void CallbackSink::write(const long* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        callback(values[i]);
+}
@@ -0,0 +1,88 @@
+/***********************************************************************
+ * OutputSink.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the OutputSink classes, the destinations of
+ *              the values a GritVM program prints with OUTPUT.
+ *
+ *              A GritContext collects OUTPUT values in a small buffer of
+ *              its own and hands them to its sink in blocks, then flushes
+ *              the sink once when a run stops, so no engine touches a
+ *              stream per value. Sinks provided:
+ *                - StreamSink: one value per line to a std::ostream
+ *                  (std::cout unless a sink is set)
+ *                - FileSink: one value per line to a file, buffered
+ *                - VectorSink: appends the values to a std::vector
+ *                - CallbackSink: calls a function with every value
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class OutputSink
+{
+    public:
+        virtual ~OutputSink() {};
+        virtual void write(const long* values, size_t count) = 0;   // receives the next [count] values printed
+        virtual void flush() {};                                     // called when a run stops
+};
+
+// Writes one value per line to a stream. Each block becomes a single stream write, so contexts on
+// different threads sharing std::cout do not interleave within a block
+class StreamSink : public OutputSink
+{
+    private:
+        std::ostream& stream;
+
+    public:
+        explicit StreamSink(std::ostream& stream) : stream(stream) {};
+        virtual void write(const long* values, size_t count);
+        virtual void flush();
+};
+
+// Writes one value per line to a file, flushing only when the run stops or the sink is destroyed
+class FileSink : public OutputSink
+{
+    private:
+        std::ofstream file;
+        std::string pending;                                    // formatted values not yet written to the file
+
+    public:
+        explicit FileSink(const std::string& filename);         // truncates [filename]; throws if it cannot be opened
+        virtual ~FileSink();
+        virtual void write(const long* values, size_t count);
+        virtual void flush();
+};
+
+// Collects the values in memory
+class VectorSink : public OutputSink
+{
+    private:
+        std::vector<long> collected;
+
+    public:
+        virtual void write(const long* values, size_t count) { collected.insert(collected.end(), values, values + count); };
+        const std::vector<long>& values() const { return collected; };
+        void clear() { collected.clear(); };
+};
+
+// Passes every value to a function
+class CallbackSink : public OutputSink
+{
+    private:
+        std::function<void(long)> callback;
+
+    public:
+        explicit CallbackSink(std::function<void(long)> callback) : callback(callback) {};
+        virtual void write(const long* values, size_t count);
+};
+
+#endif // OUTPUTSINK_H
@@ -0,0 +1,376 @@
+/***********************************************************************
+ * PagedMemory.cpp
+ * Author: Matthew Sumpter
+ * Description: Implementation file for the PagedMemory class, a data
+ *              memory of lazily allocated, shareable pages, optionally
+ *              backed by a mapped file.
+ *
+ *              See header file for class architecture
+ * *********************************************************************/
+
+#include "PagedMemory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GVM_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// bytes in one page, the unit the backing file is grown and mapped in
+static const size_t PAGE_BYTES = MEMORY_PAGE * sizeof(long);
+
+// true if the [cells] cells at [first] are all 0
+static bool allZero(const long* first, size_t cells)
+{
+    for (size_t i = 0; i < cells; ++i)
+    {
+        if (first[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+// returns a new zeroed page
+static SharedPage newPage()
+{
+    return SharedPage(new long[MEMORY_PAGE](), std::default_delete<long[]>());
+}
+
+// makes [page] writable: allocates it zeroed the first time one of its cells is written, or, if it is shared,
+// clones it unless every other holder has let it go. Pages of a backing file are always writable, so only
+// memory without one gets here
+long* PagedMemory::writablePage(size_t page)
+{
+    SharedPage& holder = holders[page];
+    if (!holder)
+    {
+        holder = newPage();
+        ++allocated;
+    }
+    else if (holder.use_count() > 1)
+    {
+        SharedPage clone(new long[MEMORY_PAGE], std::default_delete<long[]>());
+        std::memcpy(clone.get(), holder.get(), PAGE_BYTES);
+        holder = clone;
+    }
+    else    // the last other holder dropped it; see its reads before writing
+        std::atomic_thread_fence(std::memory_order_acquire);
+    table[page] = holder.get();
+    view[page] = holder.get();
+    return holder.get();
+}
+
+// releases the allocated pages from [firstPage] on; mapped pages belong to the file and stay
+void PagedMemory::freePages(size_t firstPage)
+{
+    if (descriptor >= 0)
+        return;
+    for (size_t p = firstPage; p < holders.size(); ++p)
+    {
+        if (holders[p])
+        {
+            holders[p].reset();
+            table[p] = nullptr;
+            view[p] = nullptr;
+            --allocated;
+        }
+    }
+}
+
+// makes the page table cover [cells] cells. With a backing file, the file is grown (sparse) and mapped
+// again, at least doubling, so every page stays present in the table. Throws if it cannot be
+void PagedMemory::reserve(size_t cells)
+{
+    size_t pages = (cells + PAGE_MASK) >> PAGE_SHIFT;
+#ifdef GVM_HAVE_MMAP
+    if (descriptor >= 0)
+    {
+        if (pages <= mappedPages)
+            return;
+        size_t newPages = std::max(pages, 2 * mappedPages);
+        if (mapping != nullptr)
+            munmap(mapping, mappedPages * PAGE_BYTES);
+        mapping = nullptr;
+        mappedPages = 0;
+        table.clear();
+        view.clear();
+
+        if (ftruncate(descriptor, static_cast<off_t>(newPages * PAGE_BYTES)) != 0)
+            throw std::runtime_error(file + " could not be grown");
+        void* mem = mmap(nullptr, newPages * PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        if (mem == MAP_FAILED)
+            throw std::runtime_error(file + " could not be mapped");
+        mapping = static_cast<long*>(mem);
+        mappedPages = newPages;
+        table.resize(newPages);
+        view.resize(newPages);
+        for (size_t p = 0; p < newPages; ++p)
+            view[p] = table[p] = mapping + p * MEMORY_PAGE;
+        return;
+    }
+#endif
+    if (table.size() < pages)
+    {
+        table.resize(pages, nullptr);
+        view.resize(pages, nullptr);
+        holders.resize(pages);
+    }
+}
+
+// sets cells [cell, count) to 0, keeping the invariant that cells past the end are 0 once the memory is cut.
+// Whole pages are released, or punched out of the backing file
+void PagedMemory::zeroFrom(size_t cell)
+{
+    if (cell >= count)
+        return;
+
+    size_t wholePage = (cell + PAGE_MASK) >> PAGE_SHIFT;
+    size_t partial = cell >> PAGE_SHIFT;
+    if ((cell & PAGE_MASK) != 0 && view[partial] != nullptr)
+    {
+        long* page = table[partial] ? table[partial] : writablePage(partial);
+        std::fill(page + (cell & PAGE_MASK), page + MEMORY_PAGE, 0);
+    }
+    if ((wholePage << PAGE_SHIFT) >= count)
+        return;
+
+#ifdef GVM_HAVE_MMAP
+    if (descriptor >= 0)
+    {   // cutting the file and growing it back leaves the pages mapped and reading 0, without writing them
+        if (ftruncate(descriptor, static_cast<off_t>(wholePage * PAGE_BYTES)) != 0
+            || ftruncate(descriptor, static_cast<off_t>(mappedPages * PAGE_BYTES)) != 0)
+            throw std::runtime_error(file + " could not be cut");
+        return;
+    }
+#endif
+    freePages(wholePage);
+}
+
+// inserts [value] at cell [arg], moving every later cell up by one. An unallocated page receiving a 0
+// stays unallocated
+void PagedMemory::insert(long arg, long value)
+{
+    size_t index = static_cast<size_t>(arg);
+    reserve(count + 1);
+
+    long carry = value;     // the cell moving into the page, from the page before it
+    size_t lastPage = count >> PAGE_SHIFT;
+    for (size_t p = index >> PAGE_SHIFT; p <= lastPage; ++p)
+    {
+        size_t start = (p == (index >> PAGE_SHIFT)) ? (index & PAGE_MASK) : 0;
+        if (view[p] == nullptr && carry == 0)
+            continue;
+        long* page = table[p] ? table[p] : writablePage(p);
+        long out = page[PAGE_MASK];
+        std::memmove(page + start + 1, page + start, (PAGE_MASK - start) * sizeof(long));
+        page[start] = carry;
+        carry = out;
+    }
+    ++count;
+}
+
+// erases cell [arg], moving every later cell down by one. An unallocated page receiving a 0 stays unallocated
+void PagedMemory::erase(long arg)
+{
+    size_t index = static_cast<size_t>(arg);
+    size_t lastPage = (count - 1) >> PAGE_SHIFT;
+    for (size_t p = index >> PAGE_SHIFT; p <= lastPage; ++p)
+    {
+        size_t start = (p == (index >> PAGE_SHIFT)) ? (index & PAGE_MASK) : 0;
+        long incoming = (p + 1 < view.size() && view[p + 1] != nullptr) ? view[p + 1][0] : 0;
+        if (view[p] == nullptr && incoming == 0)
+            continue;
+        long* page = table[p] ? table[p] : writablePage(p);
+        std::memmove(page + start, page + start + 1, (PAGE_MASK - start) * sizeof(long));
+        page[PAGE_MASK] = incoming;
+    }
+    --count;
+}
+
+// grows the memory to [cells] cells, the new ones 0 and no page touched, or cuts it to [cells]
+void PagedMemory::resize(size_t cells)
+{
+    if (cells > count)
+        reserve(cells);
+    else
+        zeroFrom(cells);
+    count = cells;
+}
+
+// replaces the contents with the [cells] values at [first]. Pages of zeros are left unallocated (or as
+// holes in the backing file)
+void PagedMemory::assign(const long* first, size_t cells)
+{
+    zeroFrom(0);
+    count = 0;
+    reserve(cells);
+    for (size_t start = 0; start < cells; start += MEMORY_PAGE)
+    {
+        size_t length = std::min(MEMORY_PAGE, cells - start);
+        if (allZero(first + start, length))
+            continue;
+        size_t p = start >> PAGE_SHIFT;
+        long* page = table[p] ? table[p] : writablePage(p);
+        std::memcpy(page, first + start, length * sizeof(long));
+    }
+    count = cells;
+}
+
+// copies the cells, in order, to [out], which must have room for size() cells
+void PagedMemory::copyTo(long* out) const
+{
+    for (size_t start = 0; start < count; start += MEMORY_PAGE)
+    {
+        size_t length = std::min(MEMORY_PAGE, count - start);
+        const long* page = view[start >> PAGE_SHIFT];
+        if (page)
+            std::memcpy(out + start, page, length * sizeof(long));
+        else
+            std::fill(out + start, out + start + length, 0);
+    }
+}
+
+// detaches the backing file, if any, then erases every cell
+void PagedMemory::clear()
+{
+    if (!file.empty())
+        detachFile();
+    freePages(0);
+    table.clear();
+    view.clear();
+    holders.clear();
+    count = 0;
+}
+
+// hands out the pages for a snapshot, see header. From now on every allocated page is written through
+// writablePage(), which clones it while [out] holds it
+void PagedMemory::sharePages(std::vector<SharedPage>& out)
+{
+    size_t pages = (count + PAGE_MASK) >> PAGE_SHIFT;
+    out.assign(pages, SharedPage());
+    for (size_t p = 0; p < pages; ++p)
+    {
+        if (view[p] == nullptr)
+            continue;
+        if (descriptor >= 0)
+        {   // a mapped page keeps changing with the file: copy it, leaving out pages of zeros (holes)
+            if (allZero(view[p], MEMORY_PAGE))
+                continue;
+            out[p] = newPage();
+            std::memcpy(out[p].get(), view[p], PAGE_BYTES);
+            continue;
+        }
+        out[p] = holders[p];
+        table[p] = nullptr;
+    }
+}
+
+// replaces the contents with the [cells] cells of [pages], see header. The pages are only read until written
+void PagedMemory::adoptPages(const std::vector<SharedPage>& pages, size_t cells)
+{
+    clear();
+    reserve(cells);
+    for (size_t p = 0; p < pages.size() && p < holders.size(); ++p)
+    {
+        if (!pages[p])
+            continue;
+        holders[p] = pages[p];
+        view[p] = pages[p].get();
+        ++allocated;
+    }
+    count = cells;
+}
+
+// throws if a contiguous copy of [cells] cells is more than the host's physical memory, which a sparse memory
+// of a huge index range can easily be. Hosts that do not report it accept every copy
+void PagedMemory::checkDense(size_t cells)
+{
+#ifdef GVM_HAVE_MMAP
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0 && cells > static_cast<size_t>(pages) / sizeof(long) * static_cast<size_t>(pageSize))
+        throw std::length_error("Data memory of " + std::to_string(cells) + " cells is too large to copy contiguously");
+#else
+    (void)cells;
+#endif
+}
+
+// replaces the contents with those of [filename] (see header). Throws if it cannot be opened or mapped
+void PagedMemory::mapFile(const std::string& filename)
+{
+    clear();
+
+#ifdef GVM_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd < 0)
+        throw std::runtime_error(filename + " could not be opened");
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error(filename + " could not be opened");
+    }
+    descriptor = fd;
+    file = filename;
+    size_t cells = static_cast<size_t>(info.st_size) / sizeof(long);
+    try
+    {
+        reserve(cells);
+    }
+    catch (...)
+    {
+        detachFile();
+        throw;
+    }
+    count = cells;
+#else
+    std::ifstream input(filename, std::ios::binary);
+    std::string bytes;
+    if (input)
+        bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    else if (!std::ofstream(filename, std::ios::binary | std::ios::app))
+        throw std::runtime_error(filename + " could not be opened");
+    std::vector<long> cells(bytes.size() / sizeof(long));
+    if (!cells.empty())
+        std::memcpy(cells.data(), bytes.data(), cells.size() * sizeof(long));
+    assign(cells.data(), cells.size());
+    file = filename;
+#endif
+}
+
+// cuts the backing file to the cells in memory and closes it; without mmap, writes the cells to it.
+// Leaves the memory empty. Called from the destructor, so failures to write are not thrown
+void PagedMemory::detachFile()
+{
+#ifdef GVM_HAVE_MMAP
+    if (descriptor >= 0)
+    {
+        if (mapping != nullptr)
+            munmap(mapping, mappedPages * PAGE_BYTES);
+        int cut = ftruncate(descriptor, static_cast<off_t>(count * sizeof(long)));
+        (void)cut;      // if it fails the file keeps its zero padding past the last cell
+        ::close(descriptor);
+        descriptor = -1;
+        mapping = nullptr;
+        mappedPages = 0;
+        table.clear();
+        view.clear();
+        count = 0;
+    }
+#else
+    std::vector<long> cells(count);
+    copyTo(cells.data());
+    std::ofstream output(file, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(long));
+#endif
+    file.clear();
+}
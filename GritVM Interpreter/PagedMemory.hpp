@@ -0,0 +1,129 @@
+/***********************************************************************
+ * PagedMemory.hpp
+ * Author: Matthew Sumpter
+ * Description: Header file for the PagedMemory class, an alternative data
+ *              memory for GritVM programs that use a few cells spread over
+ *              a huge index range.
+ *
+ *              The cells are split into pages of MEMORY_PAGE cells, found
+ *              through a page table with one pointer per page. A page is
+ *              only allocated the first time one of its cells is accessed,
+ *              and reads zero until written, so a memory of 10^9 cells of
+ *              which a few thousand are used costs a few pages plus the
+ *              table (8 bytes per page). Indexing ([] for AT/SET) is a
+ *              table load, a test for an unallocated page and the cell
+ *              load. resize() grows the memory without touching any page.
+ *              INSERT and ERASE shift the cells after them page by page,
+ *              skipping unallocated pages that would stay zero.
+ *
+ *              mapFile() backs the memory with a file instead: the file's
+ *              contents (native longs) become the cells, the file is
+ *              mapped shared so every change is written to it, and the
+ *              operating system allocates its pages lazily (grown files
+ *              are sparse). When the file is detached, by clear() or the
+ *              destructor, it is cut to exactly the cells in memory. On
+ *              hosts without mmap the file is read in and written back
+ *              when detached instead.
+ *
+ *              Pages are reference counted so that snapshots can share
+ *              them: sharePages() hands out the pages and adoptPages()
+ *              takes a snapshot's, both without copying a cell. A shared
+ *              page is read in place and cloned the first time it is
+ *              written while anyone else still holds it, so AT and the
+ *              other reads go through the const []. Pages of a backing
+ *              file are never shared; sharePages() copies them.
+ *
+ *              Operations that copy the whole memory out (copyTo(), and so
+ *              GritContext::getDataMem()) are as dense as the index range;
+ *              checkDense() rejects a copy that could not fit in physical
+ *              memory.
+ *
+ *              See implementation file for function descriptions
+ * *********************************************************************/
+
+#ifndef PAGEDMEMORY_H
+#define PAGEDMEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Number of data memory cells per page of a PagedMemory
+const size_t MEMORY_PAGE = 4096;
+
+// A page of MEMORY_PAGE cells, shared between PagedMemory objects and snapshots. Only a PagedMemory holding the
+// sole reference writes to it
+typedef std::shared_ptr<long> SharedPage;
+
+class PagedMemory
+{
+    private:
+        static const size_t PAGE_SHIFT = 12;                    // log2(MEMORY_PAGE)
+        static const size_t PAGE_MASK = MEMORY_PAGE - 1;
+
+        std::vector<long*> table;                               // writable page of each MEMORY_PAGE cells, nullptr until written or while shared
+        std::vector<const long*> view;                          // readable page of each MEMORY_PAGE cells, nullptr until written
+        std::vector<SharedPage> holders;                        // reference to each allocated page, empty for unallocated and mapped pages
+        size_t count;                                           // number of cells; cells past it are always 0
+        size_t allocated;                                       // allocated pages referenced by this object (not mapped from a file)
+        std::string file;                                       // backing file, empty if none
+        long* mapping;                                          // the mapped backing file, nullptr if none
+        size_t mappedPages;                                     // pages of [mapping], all present in the table
+        int descriptor;                                         // the open backing file, -1 if none
+
+        long* writablePage(size_t page);                        // slow path of []: allocates [page], or unshares it
+        void freePages(size_t firstPage);                       // releases the pages from [firstPage] on
+        void reserve(size_t cells);                             // makes the table (and the mapping) cover [cells] cells
+        void zeroFrom(size_t cell);                             // zeroes cells [cell, count)
+        void detachFile();                                      // writes back and closes the backing file
+
+        PagedMemory(const PagedMemory&);                        // shares pages only through snapshots - not copyable
+        PagedMemory& operator=(const PagedMemory&);
+
+    public:
+        PagedMemory() : count(0), allocated(0), mapping(nullptr), mappedPages(0), descriptor(-1) {};
+        ~PagedMemory() { clear(); };
+
+        size_t size() const { return count; };                  // number of cells
+        bool empty() const { return count == 0; };
+
+        // cell [i] for writing, allocating its page on first access or cloning it if shared - no error checking
+        long& operator[](size_t i)
+        {
+            long* page = table[i >> PAGE_SHIFT];
+            if (page == nullptr)
+                page = writablePage(i >> PAGE_SHIFT);
+            return page[i & PAGE_MASK];
+        };
+        // cell [i] for reading, 0 on an unallocated page - no error checking
+        long operator[](size_t i) const
+        {
+            const long* page = view[i >> PAGE_SHIFT];
+            return page ? page[i & PAGE_MASK] : 0;
+        };
+
+        void insert(long arg, long value);                      // inserts [value] at [arg], shifting the later cells up
+        void erase(long arg);                                   // erases cell [arg], shifting the later cells down
+        void resize(size_t cells);                              // grows with zero cells or cuts the memory to [cells]
+        void assign(const long* first, size_t cells);           // replaces the contents, into the backing file if any
+        void copyTo(long* out) const;                           // copies the cells to [out], which must have room for size()
+        void clear();                                           // detaches the backing file, then erases every cell
+
+        // [out] receives one entry per page, nullptr for a page never written, sharing this memory's pages: each
+        // is cloned before this memory next writes it if [out] still holds it. Pages of a backing file are copied
+        void sharePages(std::vector<SharedPage>& out);
+        // replaces the contents with the [cells] cells held in [pages] (as from sharePages()), without copying them
+        void adoptPages(const std::vector<SharedPage>& pages, size_t cells);
+        // throws std::length_error if [cells] cells stored contiguously would not fit in physical memory
+        static void checkDense(size_t cells);
+
+        // replaces the contents with those of [filename], created empty if missing, which then holds the memory until
+        // clear(). Throws if the file cannot be opened or mapped
+        void mapFile(const std::string& filename);
+        const std::string& mappedFile() const { return file; };
+
+        size_t residentPages() const { return allocated + mappedPages; };   // pages allocated or mapped
+};
+
+#endif // PAGEDMEMORY_H
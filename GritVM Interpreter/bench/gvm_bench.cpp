@@ -0,0 +1,247 @@
+/***********************************************************************
+ * gvm_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: GritVM benchmark suite. Runs the bundled programs (fact,
+ *              sumn, toh, surfarea, altseq) and generated large-loop,
+ *              large-memory and insert-heavy programs on every engine,
+ *              and on the switch and threaded engines again with checked
+ *              arithmetic (engine "switch-checked", "threaded-checked"),
+ *              and on the switch engine with a GVMTracer attached (engine
+ *              "switch-traced"), and reports for each: load time,
+ *              instructions executed, instructions per second and the
+ *              peak resident memory of the process so far. Short programs
+ *              are run repeatedly until the timing is long enough to
+ *              trust. Workloads ending in "-registers" run the program
+ *              after GVMTranslator has promoted its loops' cells to
+ *              registers. "sparse-memory" runs on PAGED_MEMORY a loop
+ *              over two cells 10^9 apart, which the other layouts could
+ *              not hold.
+ *
+ *              Output is one line per measurement, as key=value pairs, or
+ *              as JSON objects (one per line) with --json, to be collected
+ *              and compared across interpreter changes.
+ *
+ *              Usage: gvm_bench [--json] [--quick] [program directory]
+ *              The program directory defaults to the source directory the
+ *              benchmark was built from; --quick shrinks the generated
+ *              workloads for smoke testing
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+#include "GVMProfiler.hpp"
+#include "GVMTracer.hpp"
+#include "GVMTranslator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define GVM_HAVE_RUSAGE 1
+#endif
+
+#ifndef GVM_PROGRAM_DIR
+#define GVM_PROGRAM_DIR "."
+#endif
+
+// minimum time a measurement is repeated for
+static const double MIN_SECONDS = 0.2;
+
+// A program to benchmark with the initial data memory and layout to run it on, in register form if [registers].
+// Data memory is grown to [cells] cells before every run, if that is more than [memory] holds
+typedef struct _workload {
+  std::string name;
+  std::string filename;
+  std::vector<long> memory;
+  MEMORY_LAYOUT layout;
+  bool registers = false;
+  size_t cells = 0;
+} Workload;
+
+// returns the peak resident set size of the process in kilobytes, 0 where unknown
+static long peakMemoryKb()
+{
+#ifdef GVM_HAVE_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// writes [lines] to [filename] as a .gvm program
+static void writeProgram(const std::string& filename, const std::vector<std::string>& lines)
+{
+    std::ofstream out(filename, std::ios::trunc);
+    for (const std::string& line : lines)
+        out << line << "\n";
+}
+
+// returns the workloads: the bundled programs from [dir] and generated ones, written to the current directory
+static std::vector<Workload> workloads(const std::string& dir, bool quick)
+{
+    long loops = quick ? 100000 : 5000000;
+    long cells = quick ? 10000 : 1000000;
+    long gapInserts = quick ? 20000 : 1000000;
+    long vectorInserts = quick ? 5000 : 50000;
+    size_t sparseCells = 1000000000;
+
+    // mem[0] counts down to 0
+    writeProgram("bench_loop.gvm", { "CHECKMEM 1", "AT 0", "SUBCONST 1", "SET 0", "JUMPNZERO -3" });
+    // mem[0] counts down while the last of [cells] cells counts up
+    std::string last = std::to_string(cells - 1);
+    writeProgram("bench_memory.gvm", { "CHECKMEM " + std::to_string(cells), "AT " + last, "ADDCONST 1", "SET " + last,
+                                       "AT 0", "SUBCONST 1", "SET 0", "JUMPNZERO -6" });
+    // mem[0] counts down while the last of [sparseCells] cells counts up
+    std::string far = std::to_string(sparseCells - 1);
+    writeProgram("bench_sparse.gvm", { "CHECKMEM " + std::to_string(sparseCells), "AT " + far, "ADDCONST 1", "SET " + far,
+                                       "AT 0", "SUBCONST 1", "SET 0", "JUMPNZERO -6" });
+    // mem[0] counts down, every value is inserted at index 1
+    writeProgram("bench_insert.gvm", { "CHECKMEM 1", "AT 0", "JUMPZERO 5", "SUBCONST 1", "SET 0", "INSERT 1", "JUMPREL -5" });
+
+    std::vector<long> bigMemory(cells, 0);
+    bigMemory[0] = loops / 10;
+
+    return {
+        { "fact", dir + "/fact.gvm", { 20 }, VECTOR_MEMORY },
+        { "sumn", dir + "/sumn.gvm", { 1000 }, VECTOR_MEMORY },
+        { "toh", dir + "/toh.gvm", { 30 }, VECTOR_MEMORY },
+        { "surfarea", dir + "/surfarea.gvm", { 3, 4, 5 }, VECTOR_MEMORY },
+        { "altseq", dir + "/altseq.gvm", { 60 }, VECTOR_MEMORY },
+        { "large-loop", "bench_loop.gvm", { loops }, VECTOR_MEMORY },
+        { "large-memory", "bench_memory.gvm", bigMemory, VECTOR_MEMORY },
+        { "insert-heavy-vector", "bench_insert.gvm", { vectorInserts }, VECTOR_MEMORY },
+        { "insert-heavy-gap", "bench_insert.gvm", { gapInserts }, GAP_MEMORY },
+        { "sumn-registers", dir + "/sumn.gvm", { 1000 }, VECTOR_MEMORY, true },
+        { "large-loop-registers", "bench_loop.gvm", { loops }, VECTOR_MEMORY, true },
+        { "large-memory-registers", "bench_memory.gvm", bigMemory, VECTOR_MEMORY, true },
+        { "sparse-memory", "bench_sparse.gvm", { loops / 10 }, PAGED_MEMORY, false, sparseCells }
+    };
+}
+
+// returns the seconds GritProgram::fromFile takes on [filename], best of a few loads
+static double loadSeconds(const std::string& filename)
+{
+    double best = 1e30;
+    for (int r = 0; r < 5; ++r)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<const GritProgram> program = GritProgram::fromFile(filename);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// returns the number of instructions one run of [work] executes, counted by a profiled run
+static unsigned long long countInstructions(const std::shared_ptr<const GritProgram>& program, const Workload& work)
+{
+    GVMProfiler profiler;
+    GritContext context;
+    context.setMemoryLayout(work.layout);
+    context.setProfiler(&profiler);
+    context.attach(program, work.memory);
+    if (work.cells > work.memory.size())
+        context.resizeMemory(work.cells);
+    context.run(SWITCH_ENGINE);
+    return profiler.totalExecuted();
+}
+
+// runs [work] on [engine], with arithmetic checked if [checked] and recording into [tracer] if not nullptr, until
+// MIN_SECONDS have passed, returns the seconds per run; [runs] receives the run count
+static double runSeconds(const std::shared_ptr<const GritProgram>& program, const Workload& work, ENGINE engine, bool checked,
+                         GVMTracer* tracer, long& runs)
+{
+    GritContext context;
+    context.setMemoryLayout(work.layout);
+    context.setCheckedArithmetic(checked);
+    context.setTracer(tracer);
+    context.attach(program, work.memory);
+
+    double total = 0;
+    runs = 0;
+    while (total < MIN_SECONDS)
+    {
+        context.restart(work.memory);
+        if (work.cells > work.memory.size())
+            context.resizeMemory(work.cells);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        context.run(engine);
+        total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++runs;
+    }
+    return total / runs;
+}
+
+static void report(bool json, const Workload& work, const char* engine, double load, unsigned long long instructions, long runs, double seconds)
+{
+    double perSecond = (seconds > 0) ? instructions / seconds : 0;
+    if (json)
+        std::printf("{\"workload\":\"%s\",\"engine\":\"%s\",\"load_seconds\":%.6f,\"instructions\":%llu,\"runs\":%ld,"
+                    "\"seconds_per_run\":%.6f,\"instructions_per_sec\":%.0f,\"peak_rss_kb\":%ld}\n",
+                    work.name.c_str(), engine, load, instructions, runs, seconds, perSecond, peakMemoryKb());
+    else
+        std::printf("%-20s engine=%-16s load_seconds=%.6f instructions=%llu runs=%ld seconds_per_run=%.6f instructions_per_sec=%.0f peak_rss_kb=%ld\n",
+                    work.name.c_str(), engine, load, instructions, runs, seconds, perSecond, peakMemoryKb());
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    bool quick = false;
+    std::string dir = GVM_PROGRAM_DIR;
+    for (int a = 1; a < argc; ++a)
+    {
+        std::string arg = argv[a];
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--quick")
+            quick = true;
+        else
+            dir = arg;
+    }
+
+    static const ENGINE engines[] = { SWITCH_ENGINE, THREADED_ENGINE, JIT_ENGINE, SWITCH_ENGINE, THREADED_ENGINE, SWITCH_ENGINE };
+    static const bool checkedEngines[] = { false, false, false, true, true, false };
+    static const bool tracedEngines[] = { false, false, false, false, false, true };
+    static const char* const engineNames[] = { "switch", "threaded", "jit", "switch-checked", "threaded-checked", "switch-traced" };
+    GVMTracer tracer;
+
+    for (const Workload& work : workloads(dir, quick))
+    {
+        double load = loadSeconds(work.filename);
+        std::shared_ptr<const GritProgram> program = GritProgram::fromFile(work.filename);
+        if (program->status() != READY)
+        {
+            std::fprintf(stderr, "%s: %s did not load\n", work.name.c_str(), work.filename.c_str());
+            return 1;
+        }
+        if (work.registers)
+        {
+            std::vector<Instruction> translated;
+            GVMTranslator::toRegisters(program->data(), program->size(), translated);
+            program = GritProgram::fromInstructions(translated);
+        }
+        unsigned long long instructions = countInstructions(program, work);
+
+        for (int e = 0; e < 6; ++e)
+        {
+            long runs = 0;
+            double seconds = runSeconds(program, work, engines[e], checkedEngines[e], tracedEngines[e] ? &tracer : nullptr, runs);
+            report(json, work, engineNames[e], load, instructions, runs, seconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+/***********************************************************************
+ * list_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: DLinkedList node allocation benchmark. Loads a generated
+ *              program of a million instructions into a DLinkedList, the
+ *              way programs were loaded before they moved to a contiguous
+ *              array, and times filling, clearing and destroying the list
+ *              with its own NodePool, with a pool shared across loads, and
+ *              with std::list (one new per node) as the reference. Each
+ *              line reports the heap allocations made, counted by the
+ *              global operator new of this benchmark.
+ *
+ *              Usage: list_bench [instructions]
+ *              Defaults to 1000000 instructions
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "DLinkedList.hpp"
+#include "NodePool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// heap allocations made by the process so far
+static unsigned long long allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* block = std::malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+// returns seconds taken by the fastest of [repeats] runs of [fn]; [allocated] receives the allocations of the last run
+template <typename F>
+static double bestOf(int repeats, unsigned long long& allocated, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r)
+    {
+        unsigned long long before = allocations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocated = allocations - before;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static void report(const char* name, long count, double seconds, unsigned long long allocated)
+{
+    std::printf("%-24s instructions=%ld seconds=%.4f instructions_per_sec=%.0f allocations=%llu\n",
+                name, count, seconds, count / seconds, allocated);
+}
+
+int main(int argc, char* argv[])
+{
+    long count = (argc > 1) ? std::stol(argv[1]) : 1000000;
+    const int repeats = 5;
+    long checksum = 0;
+    unsigned long long allocated = 0;
+    double seconds;
+
+    // the program, cycling through the arithmetic and memory opcodes
+    std::vector<Instruction> instructions;
+    instructions.reserve(count);
+    for (long i = 0; i < count; ++i)
+        instructions.push_back(Instruction(static_cast<INSTRUCTION_SET>(i % (NOOP + 1)), i));
+    std::shared_ptr<const GritProgram> program = GritProgram::fromInstructions(instructions);
+
+    seconds = bestOf(repeats, allocated, [&]() {
+        std::list<Instruction> list;
+        for (int i = 0; i < program->size(); ++i)
+            list.push_back(program->data()[i]);
+        checksum += static_cast<long>(list.size());
+    });
+    report("std_list_load", count, seconds, allocated);
+
+    seconds = bestOf(repeats, allocated, [&]() {
+        DLinkedList list;
+        for (int i = 0; i < program->size(); ++i)
+            list.push_back(const_cast<Instruction&>(program->data()[i]));
+        checksum += list.size();
+    });
+    report("list_load", count, seconds, allocated);
+
+    // load, then clear and load again into the same list, which refills the slab it kept
+    DLinkedList reused;
+    seconds = bestOf(repeats, allocated, [&]() {
+        reused.clear();
+        for (int i = 0; i < program->size(); ++i)
+            reused.push_back(const_cast<Instruction&>(program->data()[i]));
+        checksum += reused.size();
+    });
+    report("list_clear_reload", count, seconds, allocated);
+
+    // every load is a new list, taking its nodes from a pool that outlives them
+    NodePool<Node> shared;
+    seconds = bestOf(repeats, allocated, [&]() {
+        DLinkedList list(&shared);
+        for (int i = 0; i < program->size(); ++i)
+            list.push_back(const_cast<Instruction&>(program->data()[i]));
+        checksum += list.size();
+    });
+    report("list_shared_pool_load", count, seconds, allocated);
+
+    std::printf("checksum=%ld\n", checksum);
+    return 0;
+}
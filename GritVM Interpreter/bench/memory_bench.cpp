@@ -0,0 +1,81 @@
+/***********************************************************************
+ * memory_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: Data memory layout benchmark. Runs an INSERT-heavy GritVM
+ *              program, which builds a list by inserting every value just
+ *              after a counter cell, on the VECTOR_MEMORY and GAP_MEMORY
+ *              layouts with the threaded engine. Each vector insert shifts
+ *              the whole list, so that layout is timed on a smaller list.
+ *
+ *              Usage: memory_bench [cells]
+ *              Defaults to 2000000 cells (100000 for VECTOR_MEMORY)
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// mem[0] counts down from the initial value; each iteration inserts the count at index 1
+static std::shared_ptr<const GritProgram> insertProgram()
+{
+    return GritProgram::fromInstructions({
+        Instruction(CHECKMEM, 1),
+        Instruction(AT, 0),
+        Instruction(JUMPZERO, 5),
+        Instruction(SUBCONST, 1),
+        Instruction(SET, 0),
+        Instruction(INSERT, 1),
+        Instruction(JUMPREL, -5),
+        Instruction(HALT)
+    });
+}
+
+// runs the program once on [layout] to build a list of [cells] values, returns seconds taken
+static double timeLayout(const std::shared_ptr<const GritProgram>& program, MEMORY_LAYOUT layout, long cells, long& check)
+{
+    GritContext context;
+    context.setMemoryLayout(layout);
+    context.attach(program, std::vector<long>(1, cells));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    context.run(THREADED_ENGINE);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<long> memory = context.getDataMem();
+    check = (static_cast<long>(memory.size()) == cells + 1) ? memory[1] : -1;
+    return elapsed;
+}
+
+static void report(const char* name, long cells, double seconds, long check)
+{
+    std::printf("%-14s cells=%ld seconds=%.4f inserts_per_sec=%.0f check=%ld\n", name, cells, seconds, cells / seconds, check);
+}
+
+int main(int argc, char* argv[])
+{
+    long cells = (argc > 1) ? std::stol(argv[1]) : 2000000;
+    long vectorCells = std::min(cells, 100000L);
+    std::shared_ptr<const GritProgram> program = insertProgram();
+
+    long vectorCheck = 0;
+    double vector = timeLayout(program, VECTOR_MEMORY, vectorCells, vectorCheck);
+    report("vector_memory", vectorCells, vector, vectorCheck);
+
+    long gapSmallCheck = 0;
+    double gapSmall = timeLayout(program, GAP_MEMORY, vectorCells, gapSmallCheck);
+    report("gap_memory", vectorCells, gapSmall, gapSmallCheck);
+
+    long gapCheck = 0;
+    double gap = timeLayout(program, GAP_MEMORY, cells, gapCheck);
+    report("gap_memory", cells, gap, gapCheck);
+
+    // both layouts must build the same list: 0 ends up first after the counter
+    return (vectorCheck == 0 && gapSmallCheck == 0 && gapCheck == 0) ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/***********************************************************************
+ * parse_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: Parse throughput benchmark. Generates a large synthetic
+ *              .gvm file and times the line-by-line path (std::getline +
+ *              GVMHelper::parseInstruction) against GVMParser::parse over
+ *              the whole file buffer.
+ *
+ *              Usage: parse_bench [instructions] [file]
+ *              Defaults to 1000000 instructions in parse_bench.gvm
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "GVMParser.hpp"
+#include "CustomVector.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+// writes [count] instructions cycling through every opcode, with comments and blank lines mixed in
+static void writeSyntheticProgram(const std::string& filename, long count)
+{
+    static const char* const lines[] = {
+        "CHECKMEM 3", "CLEAR", "ADDCONST 12345", "SUBCONST -7", "MULCONST 3", "DIVCONST 2",
+        "AT 1", "SET 2", "ADDMEM 0", "SUBMEM 1", "MULMEM 2", "DIVMEM 1", "INSERT 0", "ERASE 0",
+        "JUMPZERO 2   # skip ahead", "JUMPNZERO -3", "JUMPREL 1", "NOOP", "OUTPUT", "HALT"
+    };
+    const long variants = sizeof(lines) / sizeof(lines[0]);
+
+    std::ofstream out(filename);
+    for (long i = 0; i < count; ++i)
+    {
+        if (i % 50 == 0)
+            out << "# block " << i << "\n\n";
+        out << lines[i % variants] << "\n";
+    }
+}
+
+// returns seconds taken by the fastest of [repeats] runs of [fn]
+template <typename F>
+static double bestOf(int repeats, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static void report(const char* name, long count, double seconds)
+{
+    std::printf("%-14s instructions=%ld seconds=%.4f instructions_per_sec=%.0f\n", name, count, seconds, count / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    long count = (argc > 1) ? std::stol(argv[1]) : 1000000;
+    std::string filename = (argc > 2) ? argv[2] : "parse_bench.gvm";
+    const int repeats = 3;
+
+    writeSyntheticProgram(filename, count);
+
+    long parsedLegacy = 0;
+    double legacy = bestOf(repeats, [&]() {
+        CustomVector<Instruction> instructions;
+        std::ifstream file(filename);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            instructions.push_back(GVMHelper::parseInstruction(line));
+        }
+        parsedLegacy = instructions.size();
+    });
+
+    long parsedNew = 0;
+    double fast = bestOf(repeats, [&]() {
+        CustomVector<Instruction> instructions;
+        std::ifstream file(filename, std::ios::binary);
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        ParseError error;
+        if (!GVMParser::parse(source, instructions, error))
+            std::cerr << filename << ":" << error.toString() << std::endl;
+        parsedNew = instructions.size();
+    });
+
+    report("parse_legacy", parsedLegacy, legacy);
+    report("parse_gvmparser", parsedNew, fast);
+    std::printf("speedup=%.2fx\n", legacy / fast);
+
+    std::remove(filename.c_str());
+    return (parsedLegacy == parsedNew) ? 0 : 1;
+}
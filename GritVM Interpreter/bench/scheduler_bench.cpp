@@ -0,0 +1,93 @@
+/***********************************************************************
+ * scheduler_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: GritScheduler scaling benchmark. Runs the same batch of
+ *              countdown-loop jobs on 1, 2, 4, ... worker threads up to
+ *              the number of hardware threads, with the default slice and
+ *              with a short one that makes every job requeue often, and
+ *              reports jobs and instructions per second and the speedup
+ *              over one worker.
+ *
+ *              Usage: scheduler_bench [jobs] [iterations] [max threads]
+ *              Defaults to 256 jobs of 200000 iterations (5 instructions
+ *              each) and one thread per hardware thread
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "GritProgram.hpp"
+#include "GritScheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// mem[0] counts down to 0, five instructions an iteration
+static std::shared_ptr<const GritProgram> countdownProgram()
+{
+    return GritProgram::fromInstructions({
+        Instruction(AT, 0),
+        Instruction(JUMPZERO, 4),
+        Instruction(SUBCONST, 1),
+        Instruction(SET, 0),
+        Instruction(JUMPREL, -4),
+        Instruction(HALT)
+    });
+}
+
+// runs [jobs] jobs of [iterations] iterations on [threads] workers, [slice] instructions at a time; returns
+// seconds taken, from the first submission to the last result. [failed] counts jobs that did not count down to 0
+static double timeBatch(const std::shared_ptr<const GritProgram>& program, unsigned threads, unsigned long long slice,
+                        int jobs, long iterations, int& failed)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GritScheduler scheduler(threads, THREADED_ENGINE, slice);
+    std::vector<std::future<JobResult> > results;
+    for (int j = 0; j < jobs; ++j)
+        results.push_back(scheduler.submit(program, std::vector<long>(1, iterations)));
+
+    failed = 0;
+    for (std::future<JobResult>& result : results)
+    {
+        JobResult done = result.get();
+        if (done.status != HALTED || done.dataMem.empty() || done.dataMem[0] != 0)
+            ++failed;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int jobs = (argc > 1) ? std::stoi(argv[1]) : 256;
+    long iterations = (argc > 2) ? std::stol(argv[2]) : 200000;
+    unsigned maxThreads = (argc > 3) ? static_cast<unsigned>(std::stoul(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+    std::shared_ptr<const GritProgram> program = countdownProgram();
+    double instructions = static_cast<double>(jobs) * (5.0 * iterations + 3);
+    int failures = 0;
+
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < maxThreads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    const unsigned long long slices[] = { SCHEDULER_SLICE, 1 << 10 };
+    for (unsigned long long slice : slices)
+    {
+        double single = 0;
+        for (unsigned threads : counts)
+        {
+            int failed = 0;
+            double seconds = timeBatch(program, threads, slice, jobs, iterations, failed);
+            if (threads == 1)
+                single = seconds;
+            failures += failed;
+            std::printf("threads=%-3u slice=%-6llu jobs=%d seconds=%.4f jobs_per_sec=%.0f instructions_per_sec=%.0f speedup=%.2f failed=%d\n",
+                        threads, slice, jobs, seconds, jobs / seconds, instructions / seconds, single / seconds, failed);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
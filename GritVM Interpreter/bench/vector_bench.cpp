@@ -0,0 +1,103 @@
+/***********************************************************************
+ * vector_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: CustomVector throughput benchmark. Times push_back, clear,
+ *              front insert/erase and the GritVM load/reset path on a large
+ *              data memory, with std::vector as the reference for push_back.
+ *
+ *              Usage: vector_bench [elements]
+ *              Defaults to 10000000 elements
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "CustomVector.hpp"
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// returns seconds taken by the fastest of [repeats] runs of [fn]
+template <typename F>
+static double bestOf(int repeats, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static void report(const char* name, long count, double seconds)
+{
+    std::printf("%-22s elements=%ld seconds=%.4f elements_per_sec=%.0f\n", name, count, seconds, count / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    long count = (argc > 1) ? std::stol(argv[1]) : 10000000;
+    const long shifts = 20;
+    const int repeats = 3;
+    long checksum = 0;
+
+    report("std_vector_push_back", count, bestOf(repeats, [&]() {
+        std::vector<long> v;
+        for (long i = 0; i < count; ++i)
+            v.push_back(i);
+        checksum += v[count / 2];
+    }));
+
+    report("push_back", count, bestOf(repeats, [&]() {
+        CustomVector<long> v;
+        for (long i = 0; i < count; ++i)
+            v.push_back(i);
+        checksum += v[count / 2];
+    }));
+
+    CustomVector<long> filled;
+    for (long i = 0; i < count; ++i)
+        filled.push_back(i);
+
+    // clear() empties the vector, so it is timed once on a copy
+    CustomVector<long> cleared(filled);
+    report("clear", count, bestOf(1, [&]() {
+        cleared.clear();
+        checksum += static_cast<long>(cleared.size());
+    }));
+
+    // each front insert/erase shifts the whole array, so only [shifts] of them are timed
+    report("insert_erase_front", shifts, bestOf(repeats, [&]() {
+        for (long i = 0; i < shifts; ++i)
+        {
+            long front = 0;
+            filled.insert(front, i);
+            filled.erase(filled.begin());
+        }
+        checksum += filled[0];
+    }));
+
+    // GritVM load and reset of a [count]-element data memory
+    std::vector<long> memory(count, 1);
+    std::shared_ptr<const GritProgram> program = GritProgram::fromInstructions({Instruction(CHECKMEM, count)});
+    GritContext context;
+    report("context_load", count, bestOf(repeats, [&]() {
+        context.attach(program, memory);
+        checksum += static_cast<long>(context.memorySize());
+    }));
+    report("context_reset", count, bestOf(repeats, [&]() {
+        context.attach(program, memory);
+        context.reset();
+        checksum += static_cast<long>(context.memorySize());
+    }));
+
+    std::printf("checksum=%ld\n", checksum);
+    return 0;
+}
@@ -0,0 +1,596 @@
+/***********************************************************************
+ * equivalence_test.cpp
+ * Author: Matthew Sumpter
+ * Description: Engine equivalence test. Runs the bundled .gvm programs
+ *              on a range of inputs, and randomly generated programs, on
+ *              every engine (switch, threaded, JIT), every memory layout
+ *              (vector, gap buffer, paged), with fusion on and off, with
+ *              checked arithmetic on and off, and in one run or in slices
+ *              of SLICE_BUDGET instructions, and checks that every run
+ *              ends in the same state as the switch engine on vector
+ *              memory without fusion, in one run, with the same checking:
+ *              status, program counter, accumulator, registers, data
+ *              memory, OUTPUT values, the arithmetic fault and the message
+ *              of any exception thrown. Sliced runs alternate with slices
+ *              of the switch engine, which stops anywhere, so the threaded
+ *              engine also resumes inside superinstructions.
+ *
+ *              A program that overflows or divides by zero is only run
+ *              with checked arithmetic, as unchecked it is undefined.
+ *              Random programs that access memory out of bounds on the
+ *              reference run are run with bounds checking on (so the JIT
+ *              falls back to threaded); those that run past a step budget
+ *              are skipped. A run that takes longer than RUN_TIMEOUT
+ *              seconds fails the test as hung.
+ *
+ *              Every program compared is also run through GVMOptimizer,
+ *              and its optimized form run on the switch engine, with
+ *              checked arithmetic on and off, must end like the program
+ *              itself: status, registers, data memory, OUTPUT values, the
+ *              fault and exception messages and, unless an exception was
+ *              thrown, the accumulator. A few programs the optimizer
+ *              shrinks to nothing but their end, or whose dead arithmetic
+ *              overflows, are included.
+ *
+ *              Likewise each is lowered to register form by GVMTranslator,
+ *              and the translated program run on the switch engine must
+ *              end with the same status, OUTPUT values, exception message
+ *              and whether it faulted and, unless it threw or faulted
+ *              (which may leave promoted cells in their registers), the
+ *              same data memory and accumulator. Half the random programs
+ *              use no registers, so that the translator has some to use.
+ *
+ *              Finally BatchRunner::runLockstep, 4 and 8 lanes wide, must
+ *              leave every input with the status and data memory it ends
+ *              with on its own GritContext. This covers the bundled
+ *              programs and random ones (with OUTPUT, which interleaves
+ *              across lanes, turned into NOOP), over batches of inputs that
+ *              end without an exception or arithmetic fault.
+ *
+ *              Usage: equivalence_test [program directory] [programs] [seed]
+ *              Defaults to the source directory the test was built from
+ *              and 2000 random programs from seed 1. Exits non-zero and
+ *              prints the first mismatches if any run differs
+ * *********************************************************************/
+
+#include "GritVMBase.hpp"
+#include "BatchRunner.hpp"
+#include "GritProgram.hpp"
+#include "GritContext.hpp"
+#include "GVMOptimizer.hpp"
+#include "GVMTranslator.hpp"
+#include "OutputSink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GVM_PROGRAM_DIR
+#define GVM_PROGRAM_DIR "."
+#endif
+
+// Instructions a random program may run on the reference engine before it is taken to loop forever
+const unsigned long long RANDOM_BUDGET = 100000;
+
+// Initial memories per batch of a lockstep run, not a multiple of either width so the last group is partly empty
+const int LOCKSTEP_BATCH = 11;
+
+// Instructions per slice of a sliced run
+const unsigned long long SLICE_BUDGET = 5;
+
+// Seconds any one run may take before the test fails it as hung
+const int RUN_TIMEOUT = 10;
+
+// The state a run ends in
+typedef struct _outcome {
+  std::string error;                                    // what() of the exception thrown, empty if none
+  STATUS status; long programCounter; long accumulator;
+  ArithmeticFault fault;
+  std::vector<long> registers;
+  std::vector<long> dataMem;
+  std::vector<long> output;
+} Outcome;
+
+// One way of running a program
+typedef struct _configuration {
+  ENGINE engine; MEMORY_LAYOUT layout; bool fusion;
+  bool checked;                                         // checked arithmetic
+  unsigned long long slice;                             // instructions per runFor(), NO_BUDGET for one run
+} Configuration;
+
+static int mismatches = 0;
+
+// every configuration a program is compared under, filled in by main()
+static std::vector<Configuration> configurations;
+
+// the run in progress and when it counts as hung, checked by watchdog()
+static std::mutex watchLock;
+static std::string watched;
+static std::chrono::steady_clock::time_point watchDeadline = std::chrono::steady_clock::time_point::max();
+
+// fails the test, naming the run, as soon as a run passes its deadline. Runs on its own thread
+static void watchdog()
+{
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::lock_guard<std::mutex> guard(watchLock);
+        if (std::chrono::steady_clock::now() > watchDeadline)
+        {
+            std::printf("HUNG %s\n", watched.c_str());
+            std::fflush(stdout);
+            std::_Exit(1);
+        }
+    }
+}
+
+static const char* engineName(ENGINE engine)
+{
+    return engine == SWITCH_ENGINE ? "switch" : engine == THREADED_ENGINE ? "threaded" : "jit";
+}
+
+static const char* layoutName(MEMORY_LAYOUT layout)
+{
+    return layout == VECTOR_MEMORY ? "vector" : layout == GAP_MEMORY ? "gap" : "paged";
+}
+
+static std::string describe(const Configuration& config, bool boundsChecking)
+{
+    return std::string("engine=") + engineName(config.engine) + " layout=" + layoutName(config.layout) + " fusion=" + std::to_string(config.fusion)
+         + " checked=" + std::to_string(config.checked) + " sliced=" + std::to_string(config.slice != NO_BUDGET)
+         + " bounds_checking=" + std::to_string(boundsChecking);
+}
+
+// starts the watchdog's clock on the run [what]
+static void watch(const std::string& what)
+{
+    std::lock_guard<std::mutex> guard(watchLock);
+    watched = what;
+    watchDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(RUN_TIMEOUT);
+}
+
+// stops the watchdog's clock once the watched run is over
+static void unwatch()
+{
+    std::lock_guard<std::mutex> guard(watchLock);
+    watchDeadline = std::chrono::steady_clock::time_point::max();
+}
+
+// runs [program] ([name]) on [initialMemory] under [config] and returns the state it ends in. An unsliced run stops
+// after [budget] instructions
+static Outcome runOnce(const std::string& name, const std::shared_ptr<const GritProgram>& program, const std::vector<long>& initialMemory,
+                       const Configuration& config, bool boundsChecking, unsigned long long budget)
+{
+    watch(name + " " + describe(config, boundsChecking));
+
+    Outcome result;
+    GritContext context;
+    VectorSink sink;
+    context.setMemoryLayout(config.layout);
+    context.setBoundsChecking(boundsChecking);
+    context.setCheckedArithmetic(config.checked);
+    context.setOutput(&sink);
+    context.attach(program, initialMemory);
+    try
+    {
+        bool sliced = config.slice != NO_BUDGET;
+        bool onSwitch = false;
+        STATUS status = context.runFor(sliced ? config.slice : budget, config.engine);
+        while (sliced && status == RUNNING)
+        {   // every other slice runs on the switch engine, which may stop inside a superinstruction
+            onSwitch = !onSwitch;
+            status = context.runFor(config.slice, onSwitch ? SWITCH_ENGINE : config.engine);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        result.error = e.what();
+    }
+    result.status = context.status();
+    result.programCounter = context.getProgramCounter();
+    result.accumulator = context.getAccumulator();
+    result.fault = context.getFault();
+    for (int r = 0; r < GVM_REGISTERS; ++r)
+        result.registers.push_back(context.getRegister(r));
+    result.dataMem = context.getDataMem();
+    result.output = sink.values();
+
+    unwatch();
+    return result;
+}
+
+static bool same(const Outcome& a, const Outcome& b)
+{
+    return a.error == b.error && a.status == b.status && a.programCounter == b.programCounter && a.accumulator == b.accumulator
+        && a.fault.instruction == b.fault.instruction && a.fault.message == b.fault.message
+        && a.registers == b.registers && a.dataMem == b.dataMem && a.output == b.output;
+}
+
+static void printOutcome(const char* label, const Outcome& outcome)
+{
+    std::printf("  %-9s status=%s pc=%ld acc=%ld cells=%zu outputs=%zu fault=\"%s\" error=\"%s\"\n", label,
+                GVMHelper::statusToString(outcome.status).c_str(), outcome.programCounter, outcome.accumulator, outcome.dataMem.size(),
+                outcome.output.size(), (outcome.fault.instruction >= 0) ? outcome.fault.toString().c_str() : "", outcome.error.c_str());
+}
+
+static void printProgram(const std::vector<Instruction>& instructions)
+{
+    for (const Instruction& instruction : instructions)
+        std::printf("    %s %ld\n", GVMHelper::instructionToString(instruction.operation).c_str(), instruction.argument);
+}
+
+// counts a mismatch of [outcome] under [config] with [reference], printing the first few. [instructions], if not
+// empty, is the program
+static void report(const std::string& name, const std::vector<long>& initialMemory, const Configuration& config, bool boundsChecking,
+                   const Outcome& reference, const Outcome& outcome, const std::vector<Instruction>& instructions)
+{
+    if (mismatches++ >= 10)
+        return;
+    std::printf("MISMATCH %s [", name.c_str());
+    for (long value : initialMemory)
+        std::printf(" %ld", value);
+    std::printf(" ] %s\n", describe(config, boundsChecking).c_str());
+    printOutcome("expected", reference);
+    printOutcome("actual", outcome);
+    printProgram(instructions);
+}
+
+// runs [name] (built by [build] with and without fusion) under every configuration and counts those that differ from
+// the reference run with the same checking. Returns false, having run it with checked arithmetic only, if the program
+// faults with checked arithmetic. [instructions], if not empty, is printed with the first few mismatches
+template <typename Build>
+static bool compareAll(const std::string& name, Build build, const std::vector<long>& initialMemory, bool boundsChecking,
+                       const std::vector<Instruction>& instructions)
+{
+    std::shared_ptr<const GritProgram> fused = build(true), unfused = build(false);
+    Outcome checkedReference = runOnce(name, unfused, initialMemory, { SWITCH_ENGINE, VECTOR_MEMORY, false, true, NO_BUDGET }, boundsChecking, NO_BUDGET);
+    bool wellDefined = checkedReference.fault.instruction < 0;
+    Outcome uncheckedReference;
+    if (wellDefined)
+        uncheckedReference = runOnce(name, unfused, initialMemory, { SWITCH_ENGINE, VECTOR_MEMORY, false, false, NO_BUDGET }, boundsChecking, NO_BUDGET);
+
+    for (const Configuration& config : configurations)
+    {
+        if (!config.checked && !wellDefined)
+            continue;   // the unchecked overflow would be undefined behaviour
+        const Outcome& reference = config.checked ? checkedReference : uncheckedReference;
+        Outcome outcome = runOnce(name, config.fusion ? fused : unfused, initialMemory, config, boundsChecking, NO_BUDGET);
+        if (!same(reference, outcome))
+            report(name, initialMemory, config, boundsChecking, reference, outcome, instructions);
+    }
+    return wellDefined;
+}
+
+// runs [instructions] and their optimized form on the switch engine, with checked arithmetic and, if [wellDefined]
+// (the program does not fault with it), without, and counts a mismatch if they end differently. The program counter
+// and the instruction of a fault may differ, and so may the accumulator after an exception
+static void compareOptimized(const std::string& name, const std::vector<Instruction>& instructions, const std::vector<long>& initialMemory,
+                             bool boundsChecking, bool wellDefined)
+{
+    std::vector<Instruction> optimized;
+    GVMOptimizer::optimize(instructions.data(), static_cast<int>(instructions.size()), optimized);
+    std::shared_ptr<const GritProgram> original = GritProgram::fromInstructions(instructions, false);
+    std::shared_ptr<const GritProgram> shortened = GritProgram::fromInstructions(optimized, false);
+
+    for (bool checked : { true, false })
+    {
+        if (!checked && !wellDefined)
+            break;      // the unchecked overflow would be undefined behaviour
+        Configuration config = { SWITCH_ENGINE, VECTOR_MEMORY, false, checked, NO_BUDGET };
+        Outcome expected = runOnce(name, original, initialMemory, config, boundsChecking, NO_BUDGET);
+        Outcome actual = runOnce(name + " optimized", shortened, initialMemory, config, boundsChecking, NO_BUDGET);
+        if (expected.error != actual.error || expected.status != actual.status || expected.fault.message != actual.fault.message
+            || expected.registers != actual.registers || expected.dataMem != actual.dataMem || expected.output != actual.output
+            || (expected.error.empty() && expected.accumulator != actual.accumulator))
+            report(name + " optimized", initialMemory, config, boundsChecking, expected, actual, instructions);
+    }
+}
+
+// runs [instructions] and their register form on the switch engine, as compareOptimized() does, and counts a mismatch
+// if they end differently (see the header for what is compared). Returns true if the translator changed the program
+static bool compareTranslated(const std::string& name, const std::vector<Instruction>& instructions, const std::vector<long>& initialMemory,
+                              bool boundsChecking, bool wellDefined)
+{
+    std::vector<Instruction> translated;
+    TranslateReport translation = GVMTranslator::toRegisters(instructions.data(), static_cast<int>(instructions.size()), translated);
+    std::shared_ptr<const GritProgram> original = GritProgram::fromInstructions(instructions, false);
+    std::shared_ptr<const GritProgram> lowered = GritProgram::fromInstructions(translated, false);
+
+    for (bool checked : { true, false })
+    {
+        if (!checked && !wellDefined)
+            break;      // the unchecked overflow would be undefined behaviour
+        Configuration config = { SWITCH_ENGINE, VECTOR_MEMORY, false, checked, NO_BUDGET };
+        Outcome expected = runOnce(name, original, initialMemory, config, boundsChecking, NO_BUDGET);
+        Outcome actual = runOnce(name + " translated", lowered, initialMemory, config, boundsChecking, NO_BUDGET);
+        bool ended = expected.error.empty() && expected.fault.instruction < 0;
+        if (expected.error != actual.error || expected.status != actual.status || expected.output != actual.output
+            || (expected.fault.instruction < 0) != (actual.fault.instruction < 0)
+            || (ended && (expected.dataMem != actual.dataMem || expected.accumulator != actual.accumulator)))
+            report(name + " translated", initialMemory, config, boundsChecking, expected, actual, instructions);
+    }
+    return translation.loops > 0;
+}
+
+// the entries of [inputs] [instructions] runs to its end on, without running past RANDOM_BUDGET instructions, throwing
+// (bounds are checked) or faulting (arithmetic is checked)
+static std::vector<std::vector<long> > endingInputs(const std::string& name, const std::vector<Instruction>& instructions,
+                                                    const std::vector<std::vector<long> >& inputs)
+{
+    std::shared_ptr<const GritProgram> program = GritProgram::fromInstructions(instructions, false);
+    std::vector<std::vector<long> > ending;
+    for (const std::vector<long>& input : inputs)
+    {
+        Outcome probe = runOnce(name, program, input, { SWITCH_ENGINE, VECTOR_MEMORY, false, true, NO_BUDGET }, true, RANDOM_BUDGET);
+        if (probe.error.empty() && probe.status != RUNNING && probe.fault.instruction < 0)
+            ending.push_back(input);
+    }
+    return ending;
+}
+
+// runs [instructions] over [inputs] with BatchRunner::runLockstep, 4 and 8 lanes wide, and counts a mismatch for every
+// input left with another status or data memory than BatchRunner::run gives it on its own GritContext. Every input
+// must end without an exception or fault (see endingInputs()), and [instructions] must not OUTPUT
+static void compareLockstep(const std::string& name, const std::vector<Instruction>& instructions, const std::vector<std::vector<long> >& inputs)
+{
+    BatchRunner runner(GritProgram::fromInstructions(instructions, false), SWITCH_ENGINE);
+    std::vector<std::vector<long> > expected, actual;
+    Configuration config = { SWITCH_ENGINE, VECTOR_MEMORY, false, false, NO_BUDGET };
+    watch(name + " on its own contexts");
+    std::vector<STATUS> expectedStatuses = runner.run(inputs, expected);
+    unwatch();
+
+    for (unsigned width : { 4u, 8u })
+    {
+        std::string lockstep = name + " lockstep width=" + std::to_string(width);
+        Outcome reference = Outcome(), outcome = Outcome();
+        std::vector<STATUS> statuses(inputs.size(), WAITING);
+        watch(lockstep);
+        try
+        {
+            statuses = runner.runLockstep(inputs, actual, width);
+        }
+        catch (const std::exception& e)
+        {
+            outcome.error = e.what();
+            actual.assign(inputs.size(), std::vector<long>());
+        }
+        unwatch();
+
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (outcome.error.empty() && statuses[i] == expectedStatuses[i] && actual[i] == expected[i])
+                continue;
+            reference.status = expectedStatuses[i];
+            reference.dataMem = expected[i];
+            outcome.status = statuses[i];
+            outcome.dataMem = actual[i];
+            report(lockstep, inputs[i], config, false, reference, outcome, instructions);
+        }
+    }
+}
+
+// a random program of [count] instructions over a few cells and, if [registers], registers, with jumps inside the program (and the
+// occasional bad one), INSERT and ERASE, arithmetic that may overflow or divide by zero, and the increments the
+// threaded engine fuses
+static std::vector<Instruction> randomProgram(std::mt19937_64& rng, int count, bool registers)
+{
+    const INSTRUCTION_SET opcodes[] = {
+        CLEAR, AT, SET, INSERT, ERASE, ADDCONST, SUBCONST, MULCONST, DIVCONST, ADDMEM, SUBMEM, MULMEM, DIVMEM,
+        JUMPREL, JUMPZERO, JUMPNZERO, NOOP, HALT, OUTPUT, CHECKMEM, LOADREG, STOREREG, ADDREG, SUBREG, MULREG, DIVREG,
+        AT, SET, ADDCONST, SET, JUMPNZERO, LOADREG, ADDCONST, STOREREG
+    };
+    std::vector<Instruction> instructions;
+    for (int i = 0; i < count; ++i)
+    {
+        if (count - i >= 5 && rng() % 8 == 0)
+        {   // AT n; ADDCONST k; SET n or LOADREG r; ADDCONST k; STOREREG r, sometimes followed by a jump. A loop
+            // OUTPUTs every pass, so it shows a step taken twice or skipped. A large k overflows within a few steps
+            const long steps[] = { 1, -1, 2, -3, LONG_MAX / 2 + 1, LONG_MIN / 2 - 1 };
+            bool onRegister = registers && rng() % 2;
+            long index = static_cast<long>(rng() % (onRegister ? GVM_REGISTERS : 6));
+            int close = static_cast<int>(rng() % 3);
+            if (close == 1)
+                instructions.push_back(Instruction(OUTPUT));
+            instructions.push_back(Instruction(onRegister ? LOADREG : AT, index));
+            instructions.push_back(Instruction((rng() % 2) ? ADDCONST : SUBCONST, steps[rng() % 6]));
+            instructions.push_back(Instruction(onRegister ? STOREREG : SET, index));
+            if (close == 1)
+                instructions.push_back(Instruction(JUMPNZERO, -4));
+            else if (close == 2)
+                instructions.push_back(Instruction(JUMPREL, 1 + static_cast<long>(rng() % (count - i - 3))));
+            i = static_cast<int>(instructions.size()) - 1;
+            continue;
+        }
+
+        INSTRUCTION_SET op = opcodes[rng() % (sizeof(opcodes) / sizeof(opcodes[0]))];
+        while (!registers && op >= LOADREG && op <= DIVREG)
+            op = opcodes[rng() % (sizeof(opcodes) / sizeof(opcodes[0]))];
+        long arg;
+        if (op == JUMPREL || op == JUMPZERO || op == JUMPNZERO)
+        {
+            int kind = static_cast<int>(rng() % 10);
+            if (kind < 4)
+                arg = -static_cast<long>(rng() % (i + 1) + 1);
+            else if (kind == 9)
+                arg = (rng() % 2) ? 0 : count + 3;
+            else
+                arg = 1 + static_cast<long>(rng() % (count - i + 1));
+        }
+        else if (op >= LOADREG && op <= DIVREG)
+            arg = static_cast<long>(rng() % (GVM_REGISTERS + 1));
+        else if (op == DIVCONST)
+        {
+            const long divisors[] = { 2, -3, 2, -3, -1, 0 };
+            arg = divisors[rng() % 6];
+        }
+        else if (op == AT || op == SET || op == INSERT || op == ERASE || op == ADDMEM || op == SUBMEM || op == MULMEM || op == DIVMEM
+                 || op == CHECKMEM)
+            arg = static_cast<long>(rng() % 6);
+        else
+            arg = static_cast<long>(rng() % 9) - 4;
+        instructions.push_back(Instruction(op, arg));
+    }
+    return instructions;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string dir = (argc > 1) ? argv[1] : GVM_PROGRAM_DIR;
+    int programs = (argc > 2) ? std::stoi(argv[2]) : 2000;
+    std::mt19937_64 rng((argc > 3) ? std::stoull(argv[3]) : 1);
+    std::thread(watchdog).detach();
+
+    for (ENGINE engine : { SWITCH_ENGINE, THREADED_ENGINE, JIT_ENGINE })
+    {
+        for (MEMORY_LAYOUT layout : { VECTOR_MEMORY, GAP_MEMORY, PAGED_MEMORY })
+        {
+            for (bool fusion : { false, true })
+            {
+                for (bool checked : { false, true })
+                {
+                    for (unsigned long long slice : { NO_BUDGET, SLICE_BUDGET })
+                        configurations.push_back({ engine, layout, fusion, checked, slice });
+                }
+            }
+        }
+    }
+
+    // the bundled programs, including inputs they reject
+    typedef struct _case { const char* file; std::vector<long> input; } Case;
+    std::vector<Case> cases;
+    for (long n = 0; n <= 22; ++n)
+        cases.push_back({ "fact.gvm", { n } });     // 21! and 22! overflow
+    for (long n = 0; n <= 50; n += 7)
+        cases.push_back({ "sumn.gvm", { n } });
+    for (long n = 0; n <= 30; n += 3)
+        cases.push_back({ "toh.gvm", { n } });
+    for (long n = 2; n <= 12; n += 2)
+        cases.push_back({ "altseq.gvm", { n } });
+    cases.push_back({ "surfarea.gvm", { 3, 4, 5 } });
+    cases.push_back({ "surfarea.gvm", { 1 } });
+    cases.push_back({ "test.gvm", { 10 } });
+    cases.push_back({ "test.gvm", { -7 } });
+    cases.push_back({ "fact.gvm", {} });
+
+    int bundled = 0, translated = 0;
+    for (const Case& c : cases)
+    {
+        std::string path = dir + "/" + c.file;
+        std::shared_ptr<const GritProgram> probe = GritProgram::fromFile(path);
+        if (probe->status() != READY)
+        {
+            std::printf("MISSING %s\n", path.c_str());
+            ++mismatches;
+            continue;
+        }
+        bool wellDefined = compareAll(c.file, [&path](bool fuse) { return GritProgram::fromFile(path, fuse); }, c.input, false, std::vector<Instruction>());
+        std::vector<Instruction> instructions(probe->data(), probe->data() + probe->size());
+        compareOptimized(c.file, instructions, c.input, false, wellDefined);
+        translated += compareTranslated(c.file, instructions, c.input, false, wellDefined);
+        ++bundled;
+    }
+
+    // programs the optimizer reduces to their end, which must not leave an empty program (that never runs), and
+    // arithmetic whose result is never read but which overflows, faulting with checked arithmetic
+    const std::vector<std::vector<Instruction> > edgeCases = {
+        { Instruction(HALT) },
+        { Instruction(HALT), Instruction(AT, 0), Instruction(OUTPUT) },
+        { Instruction(NOOP) },
+        { Instruction(ADDCONST, 0), Instruction(JUMPREL, 1), Instruction(HALT) },
+        { Instruction(AT, 0), Instruction(ADDCONST, 1), Instruction(AT, 0), Instruction(SET, 1) },
+        { Instruction(AT, 0), Instruction(MULCONST, 2), Instruction(CLEAR), Instruction(SET, 1) }
+    };
+    const std::vector<long> edgeMemory = { LONG_MAX, 0 };
+    for (size_t p = 0; p < edgeCases.size(); ++p)
+    {
+        const std::vector<Instruction>& instructions = edgeCases[p];
+        std::string name = "optimizer case " + std::to_string(p);
+        bool wellDefined = compareAll(name, [&instructions](bool fuse) { return GritProgram::fromInstructions(instructions, fuse); },
+                                      edgeMemory, false, instructions);
+        compareOptimized(name, instructions, edgeMemory, false, wellDefined);
+        translated += compareTranslated(name, instructions, edgeMemory, false, wellDefined);
+    }
+
+    // random programs, each on a random initial memory
+    int compared = 0, checked = 0, faulted = 0;
+    for (int p = 0; p < programs; ++p)
+    {
+        std::vector<Instruction> instructions = randomProgram(rng, 2 + static_cast<int>(rng() % 24), p % 2 == 0);
+        std::vector<long> initialMemory;
+        for (int cells = static_cast<int>(rng() % 7); cells > 0; --cells)
+        {
+            const long extremes[] = { LONG_MAX, LONG_MIN, LONG_MAX - 1, LONG_MIN + 1 };
+            initialMemory.push_back((rng() % 8 == 0) ? extremes[rng() % 4] : static_cast<long>(rng() % 9) - 4);
+        }
+        std::shared_ptr<const GritProgram> program = GritProgram::fromInstructions(instructions, false);
+
+        // only programs that end are compared; those that stray out of data memory with bounds checking on. A run
+        // that throws is left RUNNING, so it is the budget running out that marks a program that may not end. The
+        // probe checks arithmetic, so no run has undefined behaviour before compareAll() knows whether it overflows
+        Outcome probe = runOnce("random " + std::to_string(p), program, initialMemory, { SWITCH_ENGINE, VECTOR_MEMORY, false, true, NO_BUDGET },
+                                true, RANDOM_BUDGET);
+        if (probe.status == RUNNING && probe.error.empty())
+            continue;
+        bool boundsChecking = probe.error == "Data memory access out of bounds";
+        bool wellDefined = compareAll("random " + std::to_string(p), [&instructions](bool fuse) { return GritProgram::fromInstructions(instructions, fuse); },
+                                      initialMemory, boundsChecking, instructions);
+        compareOptimized("random " + std::to_string(p), instructions, initialMemory, boundsChecking, wellDefined);
+        translated += compareTranslated("random " + std::to_string(p), instructions, initialMemory, boundsChecking, wellDefined);
+        if (!wellDefined)
+            ++faulted;
+        ++compared;
+        if (boundsChecking)
+            ++checked;
+    }
+
+    // the bundled programs in lockstep, each over the inputs above it ends on
+    int lockstepBatches = 0;
+    for (const char* file : { "fact.gvm", "sumn.gvm", "toh.gvm", "altseq.gvm", "surfarea.gvm", "test.gvm" })
+    {
+        std::shared_ptr<const GritProgram> program = GritProgram::fromFile(dir + "/" + file);
+        if (program->status() != READY)
+            continue;       // reported as MISSING above
+        std::vector<Instruction> instructions(program->data(), program->data() + program->size());
+        std::vector<std::vector<long> > inputs;
+        for (const Case& c : cases)
+        {
+            if (std::string(c.file) == file)
+                inputs.push_back(c.input);
+        }
+        compareLockstep(file, instructions, endingInputs(file, instructions, inputs));
+        ++lockstepBatches;
+    }
+
+    // random programs in lockstep, each over a batch of random initial memories
+    for (int p = 0; p < programs / 4; ++p)
+    {
+        std::vector<Instruction> instructions = randomProgram(rng, 2 + static_cast<int>(rng() % 24), p % 2 == 0);
+        std::replace_if(instructions.begin(), instructions.end(), [](const Instruction& i) { return i.operation == OUTPUT; }, Instruction(NOOP));
+        std::vector<std::vector<long> > inputs(LOCKSTEP_BATCH);
+        for (std::vector<long>& input : inputs)
+        {
+            for (int cells = static_cast<int>(rng() % 7); cells > 0; --cells)
+                input.push_back(static_cast<long>(rng() % 9) - 4);
+        }
+        std::string name = "random lockstep " + std::to_string(p);
+        inputs = endingInputs(name, instructions, inputs);
+        if (inputs.empty())
+            continue;
+        compareLockstep(name, instructions, inputs);
+        ++lockstepBatches;
+    }
+
+    std::printf("bundled_runs=%d random_programs=%d bounds_checked=%d faulted=%d translated=%d lockstep_batches=%d configurations=%zu mismatches=%d\n",
+                bundled, compared, checked, faulted, translated, lockstepBatches, configurations.size(), mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+/***********************************************************************
+ * gvmbc.cpp
+ * Author: Matthew Sumpter
+ * Description: Command line compiler from GritVM source (.gvm) to the
+ *              binary bytecode format (.gvmb) that GritVM::load() maps
+ *              directly. See BytecodeImage.hpp for the file layout.
+ *
+ *              Usage: gvmbc <input.gvm> [output.gvmb]
+ *              The output defaults to the input name with a .gvmb extension
+ * *********************************************************************/
+
+#include "BytecodeImage.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.gvm> [output.gvmb]" << std::endl;
+        return 2;
+    }
+
+    std::string input = argv[1];
+    std::string output;
+    if (argc == 3)
+        output = argv[2];
+    else
+    {   // swap the extension (or append one) for the default output name
+        size_t dot = input.find_last_of('.');
+        size_t slash = input.find_last_of('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            output = input + ".gvmb";
+        else
+            output = input.substr(0, dot) + ".gvmb";
+    }
+
+    try
+    {
+        int count = BytecodeImage::compile(input, output);
+        std::cout << output << ": " << count << " instructions" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/***********************************************************************
+ * gvmopt.cpp
+ * Author: Matthew Sumpter
+ * Description: Command line optimizer for GritVM programs. Loads a .gvm or
+ *              .gvmb program, runs GVMOptimizer over it and writes the
+ *              result, as .gvmb bytecode if the output name ends in .gvmb
+ *              and as .gvm source otherwise. Prints the instruction counts
+ *              before and after. With --registers the optimized program is
+ *              then lowered into register form by GVMTranslator.
+ *
+ *              Usage: gvmopt [--registers] <input> [output]
+ *              The output defaults to the input name with a .opt.gvm extension
+ * *********************************************************************/
+
+#include "GritProgram.hpp"
+#include "GVMOptimizer.hpp"
+#include "GVMTranslator.hpp"
+#include "GVMParser.hpp"
+#include "BytecodeImage.hpp"
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// writes [program] to [filename] as GritVM source, one instruction per line
+static void writeSource(const std::vector<Instruction>& program, const std::string& filename)
+{
+    std::ofstream output(filename, std::ios::trunc);
+    if (!output)
+        throw std::runtime_error(filename + " could not be opened");
+    for (const Instruction& instruct : program)
+    {
+        output << GVMHelper::instructionToString(instruct.operation);
+        if (GVMParser::takesArgument(instruct.operation) || instruct.argument != 0)
+            output << " " << instruct.argument;
+        output << "\n";
+    }
+    if (!output)
+        throw std::runtime_error(filename + " could not be written");
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool registers = !args.empty() && args[0] == "--registers";
+    if (registers)
+        args.erase(args.begin());
+    if (args.empty() || args.size() > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--registers] <input> [output]" << std::endl;
+        return 2;
+    }
+
+    std::string input = args[0];
+    std::string output;
+    if (args.size() == 2)
+        output = args[1];
+    else
+    {   // swap the extension (or append one) for the default output name
+        size_t dot = input.find_last_of('.');
+        size_t slash = input.find_last_of('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            output = input + ".opt.gvm";
+        else
+            output = input.substr(0, dot) + ".opt.gvm";
+    }
+
+    try
+    {
+        std::shared_ptr<const GritProgram> program = GritProgram::fromFile(input, false);
+        if (program->status() == ERRORED)
+        {
+            std::cerr << input << ":" << program->getLoadError().toString() << std::endl;
+            return 1;
+        }
+
+        std::vector<Instruction> optimized;
+        OptimizeReport report = GVMOptimizer::optimize(program->data(), program->size(), optimized);
+        std::string summary = report.toString();
+        if (registers)
+        {
+            std::vector<Instruction> translated;
+            TranslateReport lowered = GVMTranslator::toRegisters(optimized.data(), static_cast<int>(optimized.size()), translated);
+            optimized.swap(translated);
+            summary += "; registers: " + lowered.toString();
+        }
+
+        if (BytecodeImage::isBytecodeFile(output))
+            BytecodeImage::write(optimized.data(), static_cast<int>(optimized.size()), output);
+        else
+            writeSource(optimized, output);
+        std::cout << output << ": " << summary << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+/***********************************************************************
+ * gvmprof.cpp
+ * Author: Matthew Sumpter
+ * Description: Command line profiler for GritVM programs. Loads a .gvm or
+ *              .gvmb program, runs it on the given data memory with a
+ *              GVMProfiler attached and prints the profile, as text or as
+ *              JSON.
+ *
+ *              Usage: gvmprof [--json] [--top N] <program> [memory values...]
+ * *********************************************************************/
+
+#include "GritVM.hpp"
+#include "GVMProfiler.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    int top = 10;
+    int arg = 1;
+    for (; arg < argc && std::string(argv[arg]).compare(0, 2, "--") == 0; ++arg)
+    {
+        std::string option = argv[arg];
+        if (option == "--json")
+            json = true;
+        else if (option == "--top" && arg + 1 < argc)
+            top = std::stoi(argv[++arg]);
+        else
+            break;
+    }
+    if (arg >= argc)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--json] [--top N] <program> [memory values...]" << std::endl;
+        return 2;
+    }
+
+    std::string input = argv[arg++];
+    try
+    {
+        std::vector<long> memory;
+        for (; arg < argc; ++arg)
+            memory.push_back(std::stol(argv[arg]));
+
+        GritVM vm;
+        GVMProfiler profiler;
+        vm.setProfiler(&profiler);
+        if (vm.load(input, memory) == ERRORED)
+        {
+            std::cerr << input << ":" << vm.getLoadError().toString() << std::endl;
+            return 1;
+        }
+        vm.run();
+
+        if (json)
+            std::cout << profiler.jsonReport() << std::endl;
+        else
+            std::cout << profiler.textReport(top);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
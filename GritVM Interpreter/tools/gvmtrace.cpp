@@ -0,0 +1,78 @@
+/***********************************************************************
+ * gvmtrace.cpp
+ * Author: Matthew Sumpter
+ * Description: Command line decoder for GritVM trace dumps, as written by
+ *              GVMTracer::dump() or on an ERRORED run. Prints one line per
+ *              record, oldest first: sequence number, instruction index,
+ *              opcode and the accumulator the instruction started with.
+ *              Given the traced program with --program, each line also
+ *              shows the instruction's argument.
+ *
+ *              Usage: gvmtrace [--program <program>] [--last N] <trace>
+ * *********************************************************************/
+
+#include "GritProgram.hpp"
+#include "GVMTracer.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    std::string programFile;
+    size_t last = 0;
+    int arg = 1;
+    for (; arg < argc && std::string(argv[arg]).compare(0, 2, "--") == 0; ++arg)
+    {
+        std::string option = argv[arg];
+        if (option == "--program" && arg + 1 < argc)
+            programFile = argv[++arg];
+        else if (option == "--last" && arg + 1 < argc)
+            last = std::stoul(argv[++arg]);
+        else
+            break;
+    }
+    if (arg + 1 != argc)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--program <program>] [--last N] <trace>" << std::endl;
+        return 2;
+    }
+
+    try
+    {
+        std::vector<TraceRecord> records;
+        unsigned long long first = GVMTracer::readDump(argv[arg], records);
+
+        std::shared_ptr<const GritProgram> program;
+        if (!programFile.empty())
+        {
+            program = GritProgram::fromFile(programFile);
+            if (program->status() == ERRORED)
+            {
+                std::cerr << programFile << ":" << program->getLoadError().toString() << std::endl;
+                return 1;
+            }
+        }
+
+        size_t start = (last > 0 && last < records.size()) ? records.size() - last : 0;
+        for (size_t i = start; i < records.size(); ++i)
+        {
+            const TraceRecord& record = records[i];
+            std::string text = GVMHelper::instructionToString(static_cast<INSTRUCTION_SET>(record.operation));
+            if (program && record.instruction >= 0 && record.instruction < program->size())
+                text += " " + std::to_string(program->data()[record.instruction].argument);
+            std::printf("%12llu %6d  %-16s acc=%lld\n", first + i, record.instruction, text.c_str(),
+                        static_cast<long long>(record.accumulator));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -44,29 +44,33 @@ void HuffmanTree::char_to_prefix(const HuffmanNode* tree, std::map<char, std::st
     } 
 }
 
-// using recursive preorder traversal, maps each generated prefix string to the characters found in the leaves. Works the same
-// as char_to_prefix() function, but in prefix_to_char(), key-> prefix string, value-> char
-void HuffmanTree::prefix_to_char(const HuffmanNode *tree, std::map<std::string, char>& prefix_map, std::string inStr)
+// fills [table] with the decoding of every DECODE_BITS bit pattern, first bit most significant. Each pattern is walked
+// down [tree] from the root: a '0' bit goes to the left child and a '1' to the right, and every leaf reached adds its
+// character to the entry's symbols and restarts at the root, until DECODE_SYMBOLS are found or the pattern runs out.
+// A pattern that reaches no leaf records the node it ends on instead
+void HuffmanTree::build_decode_table(const HuffmanNode* tree, std::vector<DecodeEntry>& table) const
 {
-    // assign current node character to variable
-    char pref_char = tree->getCharacter();
+    table.assign(1 << DECODE_BITS, DecodeEntry());
 
-    // base case (should only run for leaves of the tree)
-    // if tree node is not storing a null character, assign it the current string in the map
-    if (tree->isLeaf())
+    for (int pattern = 0; pattern < (1 << DECODE_BITS); ++pattern)
     {
-        prefix_map[inStr] = pref_char;
-    }
+        DecodeEntry& entry = table[pattern];
+        const HuffmanNode* node = tree;
+        entry.count = 0;
+        entry.bits = DECODE_BITS;
 
-    if (tree->left != nullptr)
-    { // left traversal appends a '0' to the prefix string
-        std::string newStr = inStr + '0';
-        prefix_to_char(tree->left, prefix_map, newStr);
-    }
-    if (tree->right != nullptr)
-    { // right traversal appends a '1' to the prefix string
-        std::string newStr = inStr + '1';
-        prefix_to_char(tree->right, prefix_map, newStr);
+        for (int b = 0; b < DECODE_BITS && entry.count < DECODE_SYMBOLS; ++b)
+        {
+            node = ((pattern >> (DECODE_BITS - 1 - b)) & 1) ? node->right : node->left;
+            if (node->isLeaf())
+            {   // a code is complete: record its character and start the next one
+                entry.symbols[entry.count++] = node->getCharacter();
+                entry.bits = b + 1;
+                node = tree;
+            }
+        }
+
+        entry.node = (entry.count == 0) ? node : nullptr;
     }
 }
 
@@ -225,26 +229,81 @@ std::string HuffmanTree::decompress(const std::string inputCode, const std::stri
     _root = tree_stack.top();
 
     std::string decompressed = "";
-  
-    // fill [prefix] map with prefix values for characters
-    std::map<std::string, char> prefix;
-    prefix_to_char(_root, prefix, "");
-    
-    // iterate through [inputCode]. Because character prefix codes are unique, continue appending more characters from
-    // [inputCode] until a match is found, and then append the matching character to the decompressed string
-    for (auto p = inputCode.begin(); p != inputCode.end();)
+
+    // a tree of one leaf has an empty code, and a code decodes to nothing
+    if (_root->isLeaf())
+        return decompressed;
+
+    std::vector<DecodeEntry> table;
+    build_decode_table(_root, table);
+
+    // the code is read into [window], its next unread bit in the most significant position, with [available] bits in it
+    const char* next = inputCode.data();
+    const char* end = next + inputCode.size();
+    unsigned long long window = 0;
+    int available = 0;
+
+    while (true)
     {
-        std::string prefix_string = "";
+        // refill [window] with as many code characters as fit
+        while (available <= 56 && end - next >= 8)
+        {
+            unsigned long long byte = 0;
+            for (int i = 0; i < 8; ++i)
+                byte = (byte << 1) | (next[i] & 1);
+            window |= byte << (56 - available);
+            available += 8;
+            next += 8;
+        }
+        while (available < 64 && next != end)
+        {
+            window |= static_cast<unsigned long long>(*(next++) & 1) << (63 - available);
+            ++available;
+        }
+        if (available < DECODE_BITS)
+            break;
+
+        // decode every symbol the next DECODE_BITS bits complete
+        const DecodeEntry& entry = table[window >> (64 - DECODE_BITS)];
+        window <<= entry.bits;
+        available -= entry.bits;
+        if (entry.count != 0)
+        {
+            for (int i = 0; i < entry.count; ++i)
+                decompressed.push_back(entry.symbols[i]);
+            continue;
+        }
 
-        // while [prefix_string] does not match a character in [prefix] map, append another character from [inputCode]
-        while( prefix.find(prefix_string) == prefix.end() )
+        // a code longer than DECODE_BITS: finish it from the node the lookup ended on
+        const HuffmanNode* node = entry.node;
+        while (!node->isLeaf())
         {
-            prefix_string.push_back(*(p++));
+            if (available == 0)
+            {
+                if (next == end)
+                    return decompressed;         // the code ends partway through a character
+                window = static_cast<unsigned long long>(*(next++) & 1) << 63;
+                available = 1;
+            }
+            node = (window >> 63) ? node->right : node->left;
+            window <<= 1;
+            --available;
         }
+        decompressed.push_back(node->getCharacter());
+    }
 
-        // once a match is found, append the associated character to the decompressed string
-        decompressed += prefix[prefix_string];
+    // fewer than DECODE_BITS bits remain: decode them walking the tree
+    const HuffmanNode* node = _root;
+    for (; available > 0; --available)
+    {
+        node = (window >> 63) ? node->right : node->left;
+        window <<= 1;
+        if (node->isLeaf())
+        {
+            decompressed.push_back(node->getCharacter());
+            node = _root;
+        }
     }
-    
+
     return decompressed;
-}
\ No newline at end of file
+}
@@ -6,6 +6,11 @@
  *              of text with Huffman codes (http://compression.ru/download/articles/huff/huffman_1952_minimum-redundancy-codes.pdf).
  * 
  *              Stores the root of a Huffman binary tree and the number of nodes in the tree.
+ *
+ *              decompress() is table driven: a table indexed by the next DECODE_BITS bits of the code
+ *              gives the symbols those bits complete (up to DECODE_SYMBOLS) and the bits they take, so
+ *              one lookup decodes one or more symbols. Codes longer than DECODE_BITS get the tree
+ *              node the lookup ends on, and are finished by walking the tree bit by bit.
  * 
  *              See implementation file for detailed function descriptions
  * *************************************************************************************************************************************/
@@ -17,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 class HuffmanTree : public HuffmanTreeBase
 {
@@ -24,8 +30,19 @@ class HuffmanTree : public HuffmanTreeBase
         HuffmanNode* _root;                  // pointer to the root
         int _size;                           // number of elements in tree
 
+        static const int DECODE_BITS = 10;   // code bits looked up at once by decompress()
+        static const int DECODE_SYMBOLS = 4; // most symbols one lookup can decode
+
+        // decoding of one DECODE_BITS bit pattern
+        typedef struct _decode_entry {
+            char symbols[DECODE_SYMBOLS];    // symbols completed by the pattern, in order
+            unsigned char count;             // number of [symbols]; 0 if the first code is longer than the pattern
+            unsigned char bits;              // bits taken by [symbols], or DECODE_BITS if [count] is 0
+            const HuffmanNode* node;         // if [count] is 0, the node the pattern leads to
+        } DecodeEntry;
+
         void char_to_prefix(const HuffmanNode* tree, std::map<char, std::string>& prefix_map, std::string inStr);
-        void prefix_to_char(const HuffmanNode* tree, std::map<std::string, char>& prefix_map, std::string inStr);
+        void build_decode_table(const HuffmanNode* tree, std::vector<DecodeEntry>& table) const;
 
         void preorder_count(const HuffmanNode* tree);
 
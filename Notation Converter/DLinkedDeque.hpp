@@ -15,7 +15,7 @@ class DLinkedDeque {
         DLinkedList dlList;                        // double linked list of elements
         int n;                                     // number of elements in deque
     public:
-        DLinkedDeque() : n(0) {};
+        DLinkedDeque(NodePool<Node>* nodes = nullptr) : dlList(nodes), n(0) {};  // nodes from [nodes] if given
         int size() const { return n; };
         bool empty() const { return n == 0; };
         const Elem& front() const;
@@ -13,7 +13,7 @@
 // adds a new node containing element [c] to the list before [insertBefore]
 void DLinkedList::add(Node* insertBefore, const Elem& c)
 {
-    Node* newNode = new Node;            // allocate new node
+    Node* newNode = pool->allocate();    // allocate new node
     newNode->elem = c;                   // for Elem c
     newNode->next = insertBefore;        // link new nodes next
     newNode->prev = insertBefore->prev;  // link new nodes previous
@@ -29,7 +29,7 @@ void DLinkedList::remove(Node* v)
         // relink nodes, excluding [v]
         v->prev->next = v->next;
         v->next->prev = v->prev;
-        delete v;
+        pool->release(v);
     }
     else
         throw std::out_of_range("Error: List is empty");
@@ -37,11 +37,11 @@ void DLinkedList::remove(Node* v)
 
 /**************************************** Public Functions ****************************************/
 
-// constructor
-DLinkedList::DLinkedList()
+// constructor, taking nodes from [nodes] if given, else from the list's own pool
+DLinkedList::DLinkedList(NodePool<Node>* nodes) : pool(nodes ? nodes : &ownPool)
 {
-    header = new Node;
-    trailer = new Node;
+    header = pool->allocate();
+    trailer = pool->allocate();
     header->next = trailer;
     trailer->prev = header;
 }
@@ -53,8 +53,8 @@ DLinkedList::~DLinkedList()
     while (!empty())
         removeBack();
 
-    delete header;
-    delete trailer;
+    pool->release(header);
+    pool->release(trailer);
 }
 
 // returns true if list is empty
@@ -2,12 +2,16 @@
  * DLinkedList.hpp
  * Author: Matthew Sumpter
  * Description: Header file for a doubly-linked list class that uses
- *              Nodes containing strings. See implementation file for
+ *              Nodes containing strings. Nodes are taken from a NodePool
+ *              (see NodePool.hpp): the list's own, or one shared with other
+ *              lists and passed to the constructor, so lists that come and
+ *              go reuse each other's nodes. See implementation file for
  *              function descriptions
  * *********************************************************************/
 #ifndef DLINKEDLIST_H
 #define DLINKEDLIST_H
 
+#include "NodePool.hpp"
 #include <string>
 
 typedef std::string Elem;         // list element is string
@@ -20,14 +24,18 @@ class Node {
 };
 
 class DLinkedList {
-    private:                               // list sentinals
-        Node* header;
+    private:
+        NodePool<Node> ownPool;            // nodes of the list, unless given a pool
+        NodePool<Node>* pool;              // pool the nodes come from
+        Node* header;                      // list sentinals
         Node* trailer;
+        DLinkedList(const DLinkedList&);   // owns its nodes - not copyable
+        DLinkedList& operator=(const DLinkedList&);
     protected:                             // local utilities
         void add(Node* insertBefore, const Elem& c);
         void remove(Node* v);
     public:
-        DLinkedList();
+        DLinkedList(NodePool<Node>* nodes = nullptr);  // allocates from [nodes] if given, else from its own pool
         ~DLinkedList();
         bool empty() const;
         const Elem& front() const;
@@ -0,0 +1,133 @@
+/***********************************************************************************
+ * NodePool.hpp
+ * Author: Matthew Sumpter
+ * Description: Template file for the NodePool class, a slab allocator for the
+ *              nodes of DLinkedList.
+ *
+ *              Nodes are carved out of slabs, allocated with room for 32
+ *              nodes and doubling up to 4096, so filling a list costs one
+ *              allocation per slab instead of one per node and neighbouring
+ *              nodes sit next to each other in memory. A released node goes
+ *              on a free list and is handed out again by the next allocate().
+ *              clear() releases every node at once, keeping the last slab to
+ *              refill, and the destructor frees every slab; neither runs
+ *              node destructors, so nodes holding strings must be released
+ *              first.
+ *
+ *              A pool may be shared by any number of lists, on one thread.
+ * *********************************************************************************/
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>
+#include <new>
+
+template <typename N>
+class NodePool
+{
+    private:
+        // storage of one node, or the link of a free slot
+        union Slot {
+            Slot* next;
+            alignas(N) unsigned char storage[sizeof(N)];
+        };
+        // a slab's header, followed by its slots
+        struct Slab {
+            Slab* next;
+            size_t capacity;
+        };
+
+        static const size_t FIRST_SLAB = 32;
+        static const size_t LAST_SLAB = 4096;
+        static const size_t HEADER = (sizeof(Slab) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+
+        Slab* slabs;                 // slabs, most recent first
+        Slot* cursor;                // next never used slot of the most recent slab
+        Slot* limit;                 // end of the most recent slab
+        Slot* freeList;              // released slots
+        size_t held;                 // number of slabs
+        size_t live;                 // nodes allocated and not released
+
+        static Slot* slotsOf(Slab* slab) { return reinterpret_cast<Slot*>(reinterpret_cast<char*>(slab) + HEADER); };
+
+        // starts a new slab, twice the size of the last one
+        void grow()
+        {
+            size_t capacity = slabs ? slabs->capacity * 2 : FIRST_SLAB;
+            if (capacity > LAST_SLAB)
+                capacity = LAST_SLAB;
+            Slab* slab = static_cast<Slab*>(::operator new(HEADER + capacity * sizeof(Slot)));
+            slab->next = slabs;
+            slab->capacity = capacity;
+            slabs = slab;
+            cursor = slotsOf(slab);
+            limit = cursor + capacity;
+            ++held;
+        };
+
+        NodePool(const NodePool&);   // owns its slabs - not copyable
+        NodePool& operator=(const NodePool&);
+
+    public:
+        NodePool() : slabs(nullptr), cursor(nullptr), limit(nullptr), freeList(nullptr), held(0), live(0) {};
+        ~NodePool()
+        {
+            while (slabs)
+            {
+                Slab* next = slabs->next;
+                ::operator delete(slabs);
+                slabs = next;
+            }
+        };
+
+        // returns a default constructed node, reusing a released one if there is any
+        N* allocate()
+        {
+            Slot* slot;
+            if (freeList)
+            {
+                slot = freeList;
+                freeList = slot->next;
+            }
+            else
+            {
+                if (cursor == limit)
+                    grow();
+                slot = cursor++;
+            }
+            ++live;
+            return new (slot->storage) N();
+        };
+
+        // destroys [node] and keeps its slot for the next allocate()
+        void release(N* node)
+        {
+            node->~N();
+            Slot* slot = reinterpret_cast<Slot*>(node);
+            slot->next = freeList;
+            freeList = slot;
+            --live;
+        };
+
+        // releases every node without destroying it, frees every slab but the last and rewinds into that one
+        void clear()
+        {
+            if (slabs == nullptr)
+                return;
+            while (slabs->next)
+            {
+                Slab* next = slabs->next;
+                slabs->next = next->next;
+                ::operator delete(next);
+                --held;
+            }
+            cursor = slotsOf(slabs);
+            freeList = nullptr;
+            live = 0;
+        };
+
+        size_t size() const { return live; };                   // nodes allocated and not released
+        size_t slabCount() const { return held; };              // slabs currently held
+};
+
+#endif // NODEPOOL_H
@@ -11,8 +11,11 @@
  *              
  *              Note:
  *                   Instances of a DLinkedDeque are used as stacks to assist
- *                   with tracking and converting operations. See implementation
- *                   file for details on member functions
+ *                   with tracking and converting operations. Each stack takes
+ *                   its nodes from a pool of its own, local to the conversion,
+ *                   so the converter holds no state: it can be copied, and
+ *                   one instance used by several threads at once.
+ *                   See implementation file for details on member functions
  * *********************************************************************/
 #ifndef NOTATIONCONVERTER_H
 #define NOTATIONCONVERTER_H
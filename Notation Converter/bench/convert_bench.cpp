@@ -0,0 +1,170 @@
+/***********************************************************************
+ * convert_bench.cpp
+ * Author: Matthew Sumpter
+ * Description: NotationConverter benchmark. Converts long, randomly
+ *              generated expressions postfix -> infix and prefix ->
+ *              postfix (both fully parenthesized on the way through), and
+ *              pushes and pops strings through a DLinkedDeque with its own
+ *              node pool, a pool shared across deques and std::list as the
+ *              reference. Each line reports the heap allocations made,
+ *              nodes and strings together, counted by the global operator
+ *              new of this benchmark.
+ *
+ *              Build, from the Notation Converter directory:
+ *                  g++ -O2 -std=c++11 -I. bench/convert_bench.cpp NotationConverter.cpp
+ *                      DLinkedDeque.cpp DLinkedList.cpp -o convert_bench
+ *              Usage: convert_bench [operands]
+ *              Defaults to 2000 operands per expression
+ * *********************************************************************/
+
+#include "NotationConverter.hpp"
+#include "DLinkedDeque.hpp"
+#include "NodePool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <random>
+#include <string>
+
+// heap allocations made by the process so far
+static unsigned long long allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* block = std::malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+// returns seconds taken by the fastest of [repeats] runs of [fn]; [allocated] receives the allocations of the last run
+template <typename F>
+static double bestOf(int repeats, unsigned long long& allocated, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r)
+    {
+        unsigned long long before = allocations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocated = allocations - before;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static void report(const char* name, long operations, double seconds, unsigned long long allocated)
+{
+    std::printf("%-24s operations=%ld seconds=%.4f operations_per_sec=%.0f allocations=%llu\n",
+                name, operations, seconds, operations / seconds, allocated);
+}
+
+// a random postfix expression of [operands] single letter operands
+static std::string randomPostfix(int operands, std::mt19937& random)
+{
+    std::string postfix;
+    const char operators[] = "+-*/";
+    int depth = 0;              // operands on the stack
+    int remaining = operands;
+    while (remaining > 0 || depth > 1)
+    {
+        if (remaining > 0 && (depth < 2 || random() % 2 == 0))
+        {
+            postfix += static_cast<char>('a' + random() % 26);
+            --remaining;
+            ++depth;
+        }
+        else
+        {
+            postfix += operators[random() % 4];
+            --depth;
+        }
+        postfix += ' ';
+    }
+    postfix.pop_back();
+    return postfix;
+}
+
+int main(int argc, char* argv[])
+{
+    int operands = (argc > 1) ? std::stoi(argv[1]) : 2000;
+    const int repeats = 5;
+    const int conversions = 20;
+    const long pushes = 1000000;
+    size_t checksum = 0;
+    unsigned long long allocated = 0;
+    double seconds;
+
+    std::mt19937 random(20);
+    std::string postfix = randomPostfix(operands, random);
+    NotationConverter converter;
+    std::string prefix = converter.postfixToPrefix(postfix);
+
+    seconds = bestOf(repeats, allocated, [&]() {
+        for (int i = 0; i < conversions; ++i)
+            checksum += converter.postfixToInfix(postfix).size();
+    });
+    report("postfix_to_infix", conversions, seconds, allocated);
+
+    seconds = bestOf(repeats, allocated, [&]() {
+        for (int i = 0; i < conversions; ++i)
+            checksum += converter.prefixToPostfix(prefix).size();
+    });
+    report("prefix_to_postfix", conversions, seconds, allocated);
+
+    // stacks that grow to 64 strings and drain, [pushes] times in all, as a conversion uses them
+    seconds = bestOf(repeats, allocated, [&]() {
+        for (long i = 0; i < pushes; i += 64)
+        {
+            std::list<std::string> stack;
+            for (int d = 0; d < 64; ++d)
+                stack.push_front("x");
+            while (!stack.empty())
+                stack.pop_front();
+        }
+    });
+    report("std_list_stack", pushes, seconds, allocated);
+
+    seconds = bestOf(repeats, allocated, [&]() {
+        for (long i = 0; i < pushes; i += 64)
+        {
+            DLinkedDeque stack;
+            for (int d = 0; d < 64; ++d)
+                stack.insertFront("x");
+            while (!stack.empty())
+                stack.removeFront();
+        }
+    });
+    report("deque_stack", pushes, seconds, allocated);
+
+    NodePool<Node> shared;
+    seconds = bestOf(repeats, allocated, [&]() {
+        for (long i = 0; i < pushes; i += 64)
+        {
+            DLinkedDeque stack(&shared);
+            for (int d = 0; d < 64; ++d)
+                stack.insertFront("x");
+            while (!stack.empty())
+                stack.removeFront();
+        }
+    });
+    report("deque_shared_pool_stack", pushes, seconds, allocated);
+
+    std::printf("expression_chars=%zu checksum=%zu\n", postfix.size(), checksum);
+    return 0;
+}